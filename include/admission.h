@@ -0,0 +1,56 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Free heap / largest free block below which the board is under pressure
+#define ADMIT_TIGHT_FREE      40960   // heavy routes get 503, new clients wait for history
+#define ADMIT_TIGHT_BLOCK     16384
+#define ADMIT_CRITICAL_FREE   24576   // new WebSocket clients are turned away as well
+#define ADMIT_CRITICAL_BLOCK  8192
+#define ADMIT_RETRY_S         5       // Retry-After sent with a 503 or a refused socket
+
+// Per-IP token buckets, HTTP requests and WebSocket connects alike
+#define RATE_CLIENTS      8     // IPs tracked at once, least recently seen is evicted
+#define RATE_BURST        20    // requests a client may make back to back
+#define RATE_PER_S        5     // sustained requests per second
+#define RATE_HEAVY_COST   4     // a heavy route uses this many tokens
+#define RATE_UNLIMIT_MAX_S 600  // longest a load test may switch the buckets off for (ADMISSION_LOAD_TEST)
+
+enum Pressure : uint8_t {
+  PRESSURE_OK,
+  PRESSURE_TIGHT,
+  PRESSURE_CRITICAL
+};
+
+enum RouteClass : uint8_t {
+  ROUTE_LIGHT,      // rate limited only
+  ROUTE_HEAVY,      // rate limited and shed under pressure
+  ROUTE_EXEMPT      // upload completions: the body has been taken in already
+};
+
+/*
+Use :
+  timedRoute() looks the class up once per route and calls
+  admitRequest() before every handler. A shed request has already been
+  answered (429 or 503 with Retry-After) when it returns false.
+
+  Built with -DADMISSION_LOAD_TEST (env:nodemcu-32s-loadtest) only:
+  /admission?unlimit=120 switches the per-IP buckets off for two minutes
+  (0 turns them back on), so a load test from one PC measures the board
+  rather than its own rate limit. Memory shedding stays in force. Never
+  in a production image: any client could lift the limits for everyone.
+*/
+Pressure memoryPressure();
+RouteClass routeClass(const char* route);
+bool admitRequest(RouteClass cls);
+bool admitWebSocket(IPAddress ip, uint32_t& retryS);
+bool admitHistory();
+void admissionHistoryDeferred(bool late);
+#ifdef ADMISSION_LOAD_TEST
+void admissionUnlimit(uint32_t seconds);
+#endif
+String admissionJson();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <Arduino.h>
+
+#define MAX_BOOT_PHASES 16
+
+void bootMark(const char* phase);
+String bootProfileJson();
+
+#endif
\ No newline at end of file
@@ -1,8 +1,28 @@
 #ifndef FS_SPIFFS_H
 #define FS_SPIFFS_H
 
+#include <Arduino.h>
+#include <FS.h>
+
+// Build with -DUSE_LITTLEFS to mount the same "spiffs" partition as LittleFS
+#ifdef USE_LITTLEFS
+  #include <LittleFS.h>
+  #define APP_FS      LittleFS
+  #define APP_FS_NAME "littlefs"
+#else
+  #include "SPIFFS.h"
+  #define APP_FS      SPIFFS
+  #define APP_FS_NAME "spiffs"
+#endif
+
+#define FS_CHUNK_SIZE 512   // one reusable read buffer, matches the flash page cache
+
+void initSpiffsLock();   // in setup(), before the task that calls initSpiffs() starts
 void initSpiffs();
+bool fsMounted();        // false until initSpiffs() has mounted; every FS user checks it first
 String readTextFile(const char* path);
 void printVersion();
+size_t streamFile(const char* path, Print& out, size_t offset = 0, size_t len = SIZE_MAX);
+String fsInfoJson(const char* benchPath = nullptr);
 
 #endif
\ No newline at end of file
@@ -10,6 +10,10 @@ extern bool LED1status;
 extern bool LED2status;
 
 void initGPIO();
+void setOutput(uint8_t pin, bool on);
+bool isOutputPin(long pin);
+int parseOutputName(const char* name);
+String outputName(uint8_t pin);
 void saveStates();
 void loadStates();
 
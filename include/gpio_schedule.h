@@ -0,0 +1,23 @@
+#ifndef GPIO_SCHEDULE_H
+#define GPIO_SCHEDULE_H
+
+#include <Arduino.h>
+
+#define MAX_SCHEDULES 32
+#define SCHEDULE_TICK_MS 1
+#define SCHEDULE_DAY_MS  (24UL * 3600UL * 1000UL)
+
+#define SCHED_ACTION_OFF    0
+#define SCHED_ACTION_ON     1
+#define SCHED_ACTION_TOGGLE 2
+
+void initSchedules();
+void handleSchedules();
+void saveSchedules();
+int addSchedule(uint8_t pin, uint8_t action, uint32_t delayMs, uint32_t periodMs);
+int addDailySchedule(uint8_t pin, uint8_t action, uint8_t hour, uint8_t minute);
+int addPulse(uint8_t pin, uint32_t delayMs, uint32_t widthMs);
+bool cancelSchedule(uint16_t id);
+String schedulesJson();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef HTML_TEMPLATE_H
+#define HTML_TEMPLATE_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+/*
+A page is a const table of segments, laid out at compile time: literal
+text stays in flash and is written to the socket as-is, placeholder
+segments are filled by a resolver into a small stack buffer as they are
+reached. Streaming a page costs TPL_VAR_SIZE bytes of RAM however big
+it is.
+
+Use :
+  static const TemplateSegment page[] = {
+    TPL_TEXT("<p>Firmware "),
+    TPL_VAR(VAR_FW),
+    TPL_TEXT("</p>"),
+  };
+  streamTemplate(server, "text/html", TPL_SEGMENTS(page), resolvePage, nullptr);
+*/
+struct TemplateSegment {
+  const char* text;     // nullptr for a placeholder
+  uint32_t len;
+  uint8_t var;
+};
+
+#define TPL_TEXT(s)          { s, sizeof(s) - 1, 0 }
+#define TPL_VAR(id)          { nullptr, 0, id }
+#define TPL_SEGMENTS(table)  table, sizeof(table) / sizeof(table[0])
+#define TPL_VAR_SIZE         96
+
+// Filled by streamTemplate() when asked; all times from the call
+struct TemplateStats {
+  uint32_t firstByteUs;
+  uint32_t totalUs;
+  uint32_t minFreeHeap;   // lowest free heap seen between segments
+};
+
+// Writes the value of var into out (at most cap bytes) and returns its length
+typedef size_t (*TemplateResolver)(uint8_t var, char* out, size_t cap, void* ctx);
+
+void streamTemplate(WebServer& server, const char* contentType, const TemplateSegment* segs, size_t count, TemplateResolver resolve, void* ctx, TemplateStats* stats = nullptr);
+String renderTemplate(const TemplateSegment* segs, size_t count, TemplateResolver resolve, void* ctx);
+
+#endif
\ No newline at end of file
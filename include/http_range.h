@@ -0,0 +1,38 @@
+#ifndef HTTP_RANGE_H
+#define HTTP_RANGE_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "esp_partition.h"
+
+#define RANGE_WINDOW_SIZE   0x10000               // flash mapped per step, one MMU page
+#define RANGE_SLICE_SIZE    SPI_FLASH_SEC_SIZE    // handed to the socket per write
+
+/*
+Single byte-range responses (Range / If-Range / 206 / 416) for bodies
+whose size is known before the first byte goes out, so an interrupted
+download can pick up where it stopped. Multiple ranges and malformed
+headers are ignored and get the whole body, as the RFC allows.
+
+Use :
+  size_t offset, len;
+  if (!beginRangeResponse(server, size, "text/csv", etag, offset, len)) return;   // 416 sent
+  streamFile(path.c_str(), client, offset, len);
+*/
+void initRangeHeaders(WebServer& server);     // before server.begin()
+bool beginRangeResponse(WebServer& server, size_t size, const String& type, const String& etag,
+                        size_t& offset, size_t& len);
+
+/*
+App partitions (factory, ota_0, ota_1) read straight out of mapped flash,
+one 64 KB window at a time and a sector per write; nothing is buffered
+in RAM. between() runs after each window so a multi-MB download does
+not starve the rest of the loop.
+*/
+const esp_partition_t* findAppPartition(const String& label);
+String partitionEtag(const esp_partition_t* part);
+size_t streamPartition(const esp_partition_t* part, Print& out, size_t offset, size_t len,
+                       void (*between)() = nullptr);
+String partitionsJson(const String& benchLabel = "");
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef HUB_H
+#define HUB_H
+
+#include <Arduino.h>
+
+#define HUB_MAGIC               0x3142484D   // "MHB1" on the wire
+#define HUB_VERSION             1
+#define HUB_PORT                5141
+#define HUB_MAX_PEERS           16           // other boards; this one takes an extra slot
+#define HUB_HISTORY             120          // points per peer, one per poll round
+#define HUB_NAME_LEN            24
+#define HUB_BEACON_MS           10000
+#define HUB_PEER_TIMEOUT_MS     60000        // no beacon and no reply for this long: slot is freed
+#define HUB_DEFAULT_INTERVAL_MS 5000
+#define HUB_MIN_INTERVAL_MS     1000
+#define HUB_MISSING             INT16_MIN    // history point for a round the peer did not answer
+
+#define HUB_FLAG_LED1   0x01
+#define HUB_FLAG_LED2   0x02
+#define HUB_FLAG_HUB    0x04
+
+enum HubKind : uint8_t {
+  HUB_BEACON = 1,     // broadcast by every board: "I'm here"
+  HUB_REQUEST,        // hub -> peer, one per poll round
+  HUB_SNAPSHOT        // peer -> hub, answer to a request
+};
+
+/*
+Every board beacons on UDP HUB_PORT and answers snapshot requests; a
+board in hub mode also listens for beacons and polls each peer once per
+round, non-blocking, one datagram each way. Little-endian, this header
+then the kind's body. tools/hub_peers.py speaks the same protocol.
+*/
+struct __attribute__((packed)) HubHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t kind;         // HubKind
+  uint8_t mac[6];       // sender's STA MAC, the peer's identity
+};
+
+struct __attribute__((packed)) HubBeaconBody {
+  char name[HUB_NAME_LEN];
+  uint8_t flags;        // HUB_FLAG_HUB when the sender aggregates
+};
+
+struct __attribute__((packed)) HubRequestBody {
+  uint32_t round;
+};
+
+struct __attribute__((packed)) HubSnapshotBody {
+  uint32_t round;       // echoed from the request
+  uint32_t uptimeS;
+  uint32_t heapFree;
+  int16_t tempCenti;
+  int8_t rssi;
+  uint8_t clients;
+  uint8_t flags;        // HUB_FLAG_*
+};
+
+// Stored as-is in NVS
+struct HubConfig {
+  uint32_t intervalMs;
+  uint8_t enabled;      // aggregate peers
+  uint8_t beacon;       // announce this board and answer requests
+};
+
+/*
+Use :
+  initHub();                                         // after initWiFi()
+  addLoopJob("job:hub", hubStep, 50, JOB_LOW, 3000);
+  hubConfigure(5000, 1, -1);                         // hub on, 5 s rounds
+*/
+void initHub();
+void hubStep();
+bool hubConfigure(uint32_t intervalMs, int8_t enable, int8_t beacon);
+String hubJson();
+String hubHistoryJson(uint8_t slot);
+
+#endif
\ No newline at end of file
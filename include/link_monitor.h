@@ -0,0 +1,36 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <Arduino.h>
+
+#define LINK_SAMPLE_MS      2000    // STA RSSI read while associated
+#define LINK_STATION_MS     10000   // SoftAP station list refresh when no join/leave arrived
+#define LINK_EWMA_ALPHA     0.25f   // weight of each new RSSI sample
+#define LINK_RSSI_STEP      3       // smoothed dBm change worth a broadcast
+#define LINK_MAX_STATIONS   10
+
+/*
+Wi-Fi link state kept up to date by driver events plus one low-rate loop
+job, so nothing else has to ask the driver. STA up/down and SoftAP
+joins/leaves come from WiFi.onEvent(); RSSI is sampled every
+LINK_SAMPLE_MS and smoothed. Readers get the cached values.
+
+Use :
+  initLinkMonitor();     // before initWiFi(), so the first events are seen
+  addLoopJob("job:link", linkStep, 500, JOB_LOW, 1000);
+  if (linkStaUp()) h.rssi = linkRssi();
+*/
+
+struct LinkStation {
+  uint8_t mac[6];
+  int8_t rssi;          // as of the last station list refresh
+};
+
+void initLinkMonitor();
+void linkStep();
+bool linkStaUp();
+int8_t linkRssi();          // smoothed dBm, 0 while not associated
+uint8_t linkApClients();
+String linkJson();
+
+#endif
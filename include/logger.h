@@ -0,0 +1,110 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// Records above this level are compiled out entirely, arguments included.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE 64     // records in flight, must be a power of two
+#define LOG_MAX_ARGS  4
+#define LOG_STR_SIZE  24     // one copied String argument per record (%S)
+#define LOG_TAIL_SIZE 2048   // formatted text kept for /logs
+
+/*
+A record is the format pointer plus raw argument words; nothing is
+formatted until the drain task picks it up. The format string must be a
+literal and %s arguments must outlive the record. Anything transient
+(a String) is copied into the record and printed with %S; an IPAddress
+is packed into one word and printed with %I.
+*/
+struct LogRecord {
+  uint32_t ms;
+  const char* fmt;
+  uint32_t args[LOG_MAX_ARGS];
+  uint8_t level;
+  uint8_t nargs;
+  char str[LOG_STR_SIZE];
+};
+
+void initLogger();
+void logPush(const LogRecord& rec);
+String recentLogs();
+String logsSince(uint32_t& cursor);
+uint32_t logDroppedCount();
+
+inline uint32_t logArg(int v) { return (uint32_t)v; }
+inline uint32_t logArg(unsigned int v) { return v; }
+inline uint32_t logArg(long v) { return (uint32_t)v; }
+inline uint32_t logArg(unsigned long v) { return (uint32_t)v; }
+inline uint32_t logArg(const char* v) { return (uint32_t)(uintptr_t)v; }
+inline uint32_t logArg(const IPAddress& v) { return (uint32_t)v; }
+inline uint32_t logArg(double v) {
+  float f = (float)v;
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+inline void logPack(LogRecord& rec) {}
+
+template <typename T, typename... Rest>
+inline void logPack(LogRecord& rec, T v, Rest... rest) {
+  rec.args[rec.nargs++] = logArg(v);
+  logPack(rec, rest...);
+}
+
+template <typename... Rest>
+inline void logPack(LogRecord& rec, const String& v, Rest... rest) {
+  strlcpy(rec.str, v.c_str(), sizeof(rec.str));
+  rec.args[rec.nargs++] = 0;
+  logPack(rec, rest...);
+}
+
+template <typename... Args>
+inline void logEmit(uint8_t level, const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  LogRecord rec;
+  rec.ms = millis();
+  rec.fmt = fmt;
+  rec.level = level;
+  rec.nargs = 0;
+  rec.str[0] = 0;
+  logPack(rec, args...);
+  logPush(rec);
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(fmt, ...) logEmit(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) logEmit(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) logEmit(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) logEmit(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) do {} while (0)
+#endif
+
+#endif
\ No newline at end of file
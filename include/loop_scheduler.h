@@ -0,0 +1,36 @@
+#ifndef LOOP_SCHEDULER_H
+#define LOOP_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define MAX_LOOP_JOBS 12
+
+enum JobPriority : uint8_t {
+  JOB_HIGH,      // runs every pass it is due
+  JOB_NORMAL,
+  JOB_LOW        // at most one per pass, and only when nothing above it is due
+};
+
+typedef void (*JobFn)();
+
+struct LoopJob {
+  const char* name;
+  JobFn fn;
+  uint32_t periodMs;    // 0 = every pass
+  uint32_t budgetUs;    // a run longer than this counts as an overrun
+  uint32_t nextDue;
+  uint32_t runs;
+  uint32_t overruns;
+  uint32_t misses;      // started more than a full period late
+  uint32_t yields;      // passes skipped in favour of higher-priority work
+  uint32_t maxRunUs;
+  uint32_t maxLateMs;
+  int8_t metric;
+  JobPriority prio;
+};
+
+int8_t addLoopJob(const char* name, JobFn fn, uint32_t periodMs, JobPriority prio, uint32_t budgetUs);
+void runLoopJobs();
+String loopJobsJson();
+
+#endif
\ No newline at end of file
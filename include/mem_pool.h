@@ -0,0 +1,59 @@
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+
+// Configured client ceiling; everything below is sized from it at boot
+#ifndef POOL_CLIENTS
+#define POOL_CLIENTS        WEBSOCKETS_SERVER_CLIENT_MAX
+#endif
+
+#define POOL_FRAME_SIZE     1280                // one outbound WS frame: ~1 KB of JSON plus framing
+#define POOL_FRAMES         (POOL_CLIENTS / 2 + 2)   // a send holds two (copy + compressed) and returns them at once
+#define POOL_SCRATCH_SIZE   2048                // request scratch; also the deflate match table
+#define POOL_SCRATCH        2
+
+// Front of every frame block is left for the WebSocket header
+#define WS_FRAME_HEADROOM   WEBSOCKETS_MAX_HEADER_SIZE
+#define WS_FRAME_PAYLOAD    (POOL_FRAME_SIZE - WS_FRAME_HEADROOM)
+
+/*
+A fixed number of equal blocks carved out of one allocation made at boot,
+before the heap has had a chance to fragment. take() and give() are O(1)
+and only ever touch the pool's own memory, so connection churn cannot
+shrink the general heap's largest free block. Loop task only.
+
+Use :
+  char* buf = (char*)framePool.take();
+  if (!buf) return;              // exhausted: shed, don't fall back to malloc
+  ...
+  framePool.give(buf);
+*/
+class FixedPool {
+ public:
+  bool begin(const char* name, size_t blockSize, uint8_t count);
+  void* take();
+  void give(void* block);
+  size_t blockSize() const { return size; }
+  String json() const;
+
+ private:
+  const char* name = "";
+  uint8_t* base = nullptr;
+  size_t size = 0;
+  uint8_t count = 0;
+  uint32_t freeMask = 0;      // bit i set = block i free
+  uint8_t used = 0;
+  uint8_t peak = 0;
+  uint32_t takes = 0;
+  uint32_t misses = 0;        // take() with nothing free
+};
+
+extern FixedPool framePool;
+extern FixedPool scratchPool;
+
+void initPools();
+String poolsJson();
+
+#endif
\ No newline at end of file
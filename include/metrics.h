@@ -0,0 +1,17 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+#define MAX_METRIC_ROUTES 64   // routes, WebSocket events and loop jobs
+#define METRIC_BUCKETS    20   // log2 latency buckets, 1 us .. ~0.5 s
+
+WebServer::THandlerFunction timedRoute(const char* name, WebServer::THandlerFunction fn);
+int8_t metricsRegister(const char* name);
+void metricsRecord(int8_t id, uint32_t micros);
+void metricsFrameDropped();
+void metricsReset();
+String metricsJson();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include "ws_topics.h"
+
+#define MQTT_DEFAULT_PORT    1883
+#define MQTT_BATCH_MS        10000   // temperature is published in batches this far apart
+#define MQTT_BATCH_SAMPLES   60      // samples per temperature publish
+#define MQTT_FLUSH_BATCHES   4       // publishes per step while draining a backlog
+#define MQTT_BUFFER_SIZE     1280    // PubSubClient packet buffer, one full batch
+#define MQTT_EVENT_QUEUE     8       // GPIO / OTA events held while offline
+#define MQTT_EVENT_SIZE      112
+#define MQTT_RETRY_MIN_MS    2000    // reconnect backoff, doubling up to the max
+#define MQTT_RETRY_MAX_MS    60000
+#define MQTT_SOCKET_TIMEOUT_S 2      // TCP connect and CONNACK wait, both inside the loop job
+
+// Stored as-is in NVS
+struct MqttConfig {
+  char host[40];        // broker IP; hostnames are refused, a DNS lookup would block the loop
+  uint16_t port;
+  char base[40];        // topic prefix, DEVICE_NAME/<mac tail> when empty
+  uint8_t enabled;
+};
+
+/*
+Topics under <base>:
+  online          "1" / "0" (retained, last will)
+  temp            {"samples":[[seconds,degC],...]}
+  gpio, ota       the same JSON events the WebSocket carries
+  cmd/<output>    subscribed; "on" / "off" for led1, led2, gpioN
+
+Samples are not copied into a queue while the broker is out of reach:
+the publisher keeps a cursor into the temperature series and resumes
+from it, so the offline backlog is bounded by the series itself. No
+samples go out while a replay is active; the cursor waits and catches up
+afterwards.
+*/
+void initMqtt();
+void mqttStep();
+void mqttPublishEvent(WsTopic topic, const String& json);
+bool mqttConfigure(const String& host, uint16_t port, const String& base, int8_t enable);
+String mqttJson();
+
+#endif
\ No newline at end of file
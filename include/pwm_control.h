@@ -0,0 +1,25 @@
+#ifndef PWM_CONTROL_H
+#define PWM_CONTROL_H
+
+#include <Arduino.h>
+
+#define PWM_CHANNELS        4       // on LEDC channels 0, 2, 4, 6: one timer each
+#define PWM_RESOLUTION_BITS 10
+#define PWM_MAX_DUTY        ((1 << PWM_RESOLUTION_BITS) - 1)
+#define PWM_DEFAULT_FREQ    5000
+
+struct PwmChannel {
+  uint8_t pin;        // 0xFF = unassigned
+  uint16_t duty;      // target duty, reached once a fade completes
+  uint32_t freq;
+};
+
+extern PwmChannel pwmChannels[PWM_CHANNELS];
+
+void initPWM();
+bool pwmConfigure(uint8_t ch, uint8_t pin, uint32_t freq);
+bool pwmSetDuty(uint8_t ch, uint16_t duty, uint32_t fadeMs);
+void savePwmStates();
+String pwmJson();
+
+#endif
\ No newline at end of file
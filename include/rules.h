@@ -0,0 +1,34 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+
+#define MAX_RULES 100
+
+#define RULE_OP_GT 1
+#define RULE_OP_LT 2
+
+/*
+One compiled rule, stored as-is in NVS. Text form:
+  temp>55 for 10 hyst 2 then led2 on
+  "for" (seconds the condition must hold) and "hyst" (degrees the
+  temperature must fall back past the threshold before the rule
+  releases and the output is reverted) are optional.
+*/
+struct __attribute__((packed)) RuleCode {
+  uint8_t op;          // RULE_OP_GT / RULE_OP_LT
+  uint8_t pin;         // output GPIO
+  int16_t threshold;   // centi-degrees C
+  uint8_t hyst;        // deci-degrees C
+  uint8_t action;      // level applied when the rule fires
+  uint16_t holdSec;
+};
+
+void initRules();
+void evaluateRules(float tempC, unsigned long nowMillis);
+bool addRule(const String& text, String& error);
+bool deleteRule(uint8_t id);
+void clearRules();
+String rulesJson();
+
+#endif
\ No newline at end of file
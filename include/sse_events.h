@@ -0,0 +1,12 @@
+#ifndef SSE_EVENTS_H
+#define SSE_EVENTS_H
+
+#include <Arduino.h>
+
+#define MAX_SSE_CLIENTS 4
+
+void handleEventsConnect();
+void sseBroadcast(const String& json);
+uint8_t sseClientCount();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <Arduino.h>
+
+enum Heartbeat : uint8_t {
+  HB_LOOP,        // every loop() pass
+  HB_WS,          // after webSocket.loop()
+  HB_SAMPLE,      // each temperature sample
+  HB_COUNT
+};
+
+#define STALL_REPORT_MS   3000    // a heartbeat this old captures a report
+#define STALL_REBOOT_MS   15000   // ...and this old restarts the board
+#define STALL_HOLD_MAX_MS 600000  // longest a declared transfer may suspend the reboot
+#define STALL_TASKS       10
+
+struct StallTask {
+  char name[12];
+  uint16_t stackFree;     // bytes never touched since the task started
+};
+
+// Lives in RTC memory so the report outlasts the reboot it triggers
+struct StallReport {
+  uint32_t magic;
+  uint32_t crc;
+  uint32_t uptimeMs;
+  uint32_t stalledMs;
+  char heartbeat[8];
+  char activity[24];      // job or route that was running
+  uint32_t activityMs;    // how long it had been running
+  uint32_t heapFree;
+  uint32_t heapMinFree;
+  uint32_t heapLargest;
+  uint8_t fragPct;
+  uint8_t rebooted;
+  uint8_t taskCount;
+  StallTask tasks[STALL_TASKS];
+};
+
+void initSupervisor();
+void superBeat(Heartbeat hb);
+const char* superEnter(const char* activity);
+void superLeave(const char* previous);
+void superHold(const char* why);
+void superRelease();
+String stallReportJson();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef TEMP_SERIES_H
+#define TEMP_SERIES_H
+
+#include <Arduino.h>
+
+#define SERIES_BLOCK_BYTES 128
+#define SERIES_BLOCKS      36   // 4.5 KB, about what the raw 600-sample buffers used
+#define SERIES_NOMINAL_DS  10   // expected sample spacing in deciseconds
+
+/*
+  One sealed-or-open block. The first sample lives in the header, every
+  following one is bit-packed into data[]:
+    time  : delta-of-delta in deciseconds   0 | 10+7b | 110+9b | 1110+12b | 1111+32b
+    value : delta in centi-degrees          0 | 10+8b | 110+12b | 111+16b (absolute)
+  Signed fields are zigzag encoded.
+*/
+struct SeriesBlock {
+  uint32_t t0;        // deciseconds since boot
+  int16_t v0;         // centi-degrees
+  uint16_t count;
+  uint16_t bits;      // bits used in data[]
+  uint8_t data[SERIES_BLOCK_BYTES - 10];
+};
+
+class TempSeries {
+ public:
+  class Reader {
+   public:
+    bool next(uint32_t& tDs, int16_t& vCenti);
+   private:
+    friend class TempSeries;
+    const TempSeries* series;
+    uint8_t block;
+    uint8_t blocksLeft;
+    uint16_t index;
+    uint16_t bitPos;
+    uint32_t t;
+    int32_t delta;
+    int16_t v;
+  };
+
+  TempSeries() { clear(); }
+  void clear();
+  void append(uint32_t tDs, int16_t vCenti);
+  Reader reader(uint32_t skip = 0) const;
+  Reader readerAfter(uint32_t tDs, bool& fromStart) const;
+  uint32_t size() const { return samples; }
+  uint8_t blocksUsed() const { return used; }
+  uint32_t bitsUsed() const;
+  uint32_t lastTime() const { return used ? lastT : 0; }
+
+ private:
+  SeriesBlock blocks[SERIES_BLOCKS];
+  uint8_t head;
+  uint8_t used;
+  uint32_t samples;
+  uint32_t lastT;
+  int32_t lastDelta;
+  int16_t lastV;
+};
+
+extern TempSeries& tempSeries;
+
+void initTempSeries(bool keep);
+uint32_t seriesNowDs();
+String seriesStatsJson(const char* benchCsv = nullptr);
+size_t seriesJsonChunk(TempSeries::Reader& r, char* out, size_t cap);
+
+#define SERIES_JSON_ITEM_MAX 40   // longest {"time":..,"temp":..} item plus its comma
+
+#endif
\ No newline at end of file
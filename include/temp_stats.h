@@ -0,0 +1,52 @@
+#ifndef TEMP_STATS_H
+#define TEMP_STATS_H
+
+#include <Arduino.h>
+
+#define STATS_SLOTS 60   // each sliding window is 60 equal slots
+
+// Count, mean and sum of squared deviations (Welford)
+struct StatsAgg {
+  uint32_t n;
+  double mean;
+  double m2;
+};
+
+struct StatsExtreme {
+  uint32_t seq;
+  float value;
+};
+
+struct StatsWindow {
+  const char* name;
+  uint32_t slotMs;
+  uint32_t slotStart;
+  uint32_t seq;                 // index of the current slot since boot
+  uint8_t cur;
+  struct { float mean; float m2; uint16_t n; } slots[STATS_SLOTS];
+  StatsAgg total;
+  // Monotonic deques over slot minima / maxima, oldest at head
+  StatsExtreme minQ[STATS_SLOTS + 1];
+  StatsExtreme maxQ[STATS_SLOTS + 1];
+  uint8_t minHead, minLen, maxHead, maxLen;
+};
+
+#define STATS_WINDOWS 3   // 1m, 10m, 1h
+
+// Everything the windows and since-boot figures need; the board keeps one
+// (liveStats), a replay builds its own so it never touches the live one
+struct TempStats {
+  StatsWindow windows[STATS_WINDOWS];
+  StatsAgg sinceBoot;
+  float bootMin, bootMax;
+  bool started;
+  TempStats();
+};
+
+extern TempStats liveStats;
+
+void statsAdd(float tempC, unsigned long ms, TempStats& s = liveStats);
+void statsReset(TempStats& s = liveStats);
+String statsJson(const TempStats& s = liveStats);
+
+#endif
\ No newline at end of file
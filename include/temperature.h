@@ -1,9 +1,24 @@
 #ifndef TEMPERATURE_H
 #define TEMPERATURE_H
 
-#define MAX_TEMP_POINTS 600  // adjust as RAM capacity 10min @1/Sec
+#include <Arduino.h>
+
+#define MAX_TEMP_POINTS 600  // points replayed to the chart, 10min @1/Sec
+
+// Stages of one sample, for callers that want them timed separately
+enum IngestStage : uint8_t {
+  INGEST_RULES,
+  INGEST_SERIES,
+  INGEST_STATS,
+  INGEST_STAGES
+};
+
+class TempSeries;
+struct TempStats;
 
 void updateTemperature();
+float ingestTemperature(uint8_t raw, unsigned long ms, uint32_t ds, TempSeries& series, TempStats& stats,
+                        bool rules = true, uint32_t* stageUs = nullptr);
 extern float currentTempC;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <Arduino.h>
+
+#define TRACE_PATH          "/trace.bin"
+#define TRACE_BUF_RECORDS   64      // records buffered in RAM between flash writes
+#define TRACE_MIN_FREE      16384   // capture stops before the filesystem is this full
+#define REPLAY_SLICE_US     15000   // replay work per loop pass, so HTTP and WS stay live
+
+enum TraceKind : uint8_t {
+  TRACE_SAMPLE,     // arg = raw temprature_sens_read() byte
+  TRACE_REQUEST     // arg = TraceRequest
+};
+
+// Requests worth replaying: the read-only bodies the dashboard polls
+enum TraceRequest : uint8_t {
+  REQ_STATUS,
+  REQ_STATS,
+  REQ_HISTORY,
+  REQ_HISTORY_STATS,
+  REQ_TOPICS,
+  REQ_LOOP,
+  REQ_PAGE,
+  REQ_WS_STATUS,
+  REQ_COUNT
+};
+
+// One event as stored in TRACE_PATH, little-endian, 6 bytes
+struct __attribute__((packed)) TraceRecord {
+  uint32_t ms;      // since capture start
+  uint8_t kind;
+  uint8_t arg;
+};
+
+/*
+Capture appends every temperature sample and every replayable request to
+TRACE_PATH. Replay feeds that file back through ingestTemperature() and
+the same JSON builders the routes use, on a clock taken from the records,
+as fast as the loop allows. It fills a scratch series and stats of its
+own, allocated per run and starting empty, so two runs over the same file
+do the same work and end in the same state ("digest"), and the live 24 h
+history (and its warm-restart copy) is never touched. Only a rules replay
+pauses the live sampler, since the rule state and outputs are shared.
+
+Use :
+  /trace?capture=1            start recording (truncates TRACE_PATH)
+  /trace?capture=0            stop and flush
+  POST /trace                 upload a trace recorded elsewhere
+  /replay?start=1             replay TRACE_PATH; &rules=1 also evaluates
+                              rules (drives real outputs), &hold=1 keeps
+                              the replayed history until /replay?stop=1
+  /replay                     progress, per-stage cost, replayed stats
+  /replay?history=1           the replayed (or held) series, as /history
+*/
+void traceCapture(bool on);
+void traceSample(uint8_t raw, unsigned long ms);
+void traceRequest(const char* route);
+bool traceUpload(const uint8_t* data, size_t len, bool first, bool last);
+String traceJson();
+
+class TempSeries;
+
+bool replayActive();
+bool replayDrivesRules();
+const TempSeries* replaySeries();
+bool replayStart(bool rules, bool hold, String& error);
+void replayStop();
+void replayStep();
+String replayJson();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef UDP_EXPORT_H
+#define UDP_EXPORT_H
+
+#include <Arduino.h>
+
+#define UDP_MAGIC                0x3154444D   // "MDT1" on the wire
+#define UDP_VERSION              1
+#define UDP_MAX_SAMPLES          128          // keeps a datagram well under one MTU
+#define UDP_FLUSH_DATAGRAMS      4            // datagrams per step while a backlog drains
+#define UDP_DEFAULT_PORT         5140
+#define UDP_DEFAULT_INTERVAL_MS  5000
+#define UDP_MIN_INTERVAL_MS      500
+
+#define UDP_FLAG_LED1   0x01
+#define UDP_FLAG_LED2   0x02
+
+/*
+One datagram, little-endian: this header, then count UdpSample.
+Collectors detect loss from gaps in seq; tools/udp_receiver.py decodes it.
+
+The exporter keeps a cursor into the temperature series and walks forward
+from it, so a backlog (longer interval, link outage) goes out as several
+datagrams in a row rather than being skipped. Samples that fell out of
+the series before they could be sent are counted as dropped_samples in
+/udp. While a replay is active the datagrams carry status only.
+*/
+struct __attribute__((packed)) UdpHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t flags;        // UDP_FLAG_*
+  uint16_t count;
+  uint32_t seq;
+  uint32_t uptimeS;
+  uint32_t heapFree;
+  uint32_t heapMinFree;
+  int8_t rssi;          // 0 when not associated
+  uint8_t reserved[3];
+  uint32_t t0;          // deciseconds since boot of the first sample
+};
+
+struct __attribute__((packed)) UdpSample {
+  uint16_t dtDs;        // deciseconds after t0
+  int16_t vCenti;
+};
+
+// Stored as-is in NVS
+struct UdpConfig {
+  uint32_t ip;          // unicast or multicast destination, 0 = none
+  uint16_t port;
+  uint32_t intervalMs;
+  uint8_t enabled;
+};
+
+void initUdpExport();
+void udpExportStep();
+bool udpConfigure(const String& host, uint16_t port, uint32_t intervalMs, int8_t enable);
+String udpJson();
+
+#endif
\ No newline at end of file
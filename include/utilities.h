@@ -3,7 +3,10 @@
 
 #define FW_VERSION "v0.3.3"
 #define DEVICE_NAME  "mingledash"
+#define TIME_ZONE    "UTC0"          // POSIX TZ string used once SNTP has synced
+#define NTP_SERVER   "pool.ntp.org"
 
 unsigned long getUptimeMillis(unsigned long bootMillis);
+long msUntilTimeOfDay(int hour, int minute);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef WARM_RESTART_H
+#define WARM_RESTART_H
+
+#include <Arduino.h>
+
+#define WARM_MAGIC   0x57524D31   // "WRM1"
+#define WARM_VERSION 1
+
+// Lives in RTC slow memory next to the history it vouches for
+struct WarmHeader {
+  uint32_t magic;
+  uint32_t layout;          // WARM_VERSION and struct sizes, so a new image with a different layout starts cold
+  uint32_t crc;             // header fields below plus the retained series
+  uint32_t warmRestores;
+  uint32_t uptimeBaseS;     // uptime accumulated over previous warm runs
+  uint8_t led1;
+  uint8_t led2;
+};
+
+bool warmRestore();
+void warmSave();
+String warmJson();
+
+#endif
\ No newline at end of file
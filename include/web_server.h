@@ -1,9 +1,33 @@
 #ifndef WEB_SERVER_H
 #define WEB_SERVER_H
 
+#include <Arduino.h>
+#include <WebServer.h>
+#include "ws_topics.h"
+
+// A handler that keeps its socket (the /events stream) takes it with
+// detachClient(). handleClient() then finds no client and goes straight
+// back to HC_NONE, instead of sitting in HC_WAIT_CLOSE for
+// HTTP_MAX_CLOSE_WAIT and serving nobody else meanwhile.
+class HandoffWebServer : public WebServer {
+ public:
+  using WebServer::WebServer;
+
+  WiFiClient detachClient() {
+    WiFiClient client = _currentClient;
+    _currentClient = WiFiClient();
+    _currentStatus = HC_NONE;
+    return client;
+  }
+};
+
+extern HandoffWebServer server;
+
 void initWebServer();
 void initWebSocket();
 void handleClients();
+void pushTelemetry();
+void pushLogs();
 void handle_OnConnect();
 void handle_led1on();
 void handle_led1off();
@@ -12,8 +36,26 @@ void handle_led2off();
 void handle_temperature();
 void handle_NotFound();
 void handleGPIOControl();
+void handlePWMControl();
+void handleFileDownload();
+void handlePartitionDownload();
+void handleHistory();
+void handleReplay();
+void handleUdpExport();
+void handleMqtt();
+void handleHubPage();
+void handleHubPeers();
+void handleHubHistory();
+void handleSchedule();
+void handleRules();
+void handleRuleAdd();
+void handleRuleDelete();
 void handleOtaUpdate();
 
 String SendHTML(uint8_t led1stat, uint8_t led2stat);
+String statusJson();
+void setLed(uint8_t num, bool on);
+String pageStatsJson();
+void broadcastEvent(const String& json, WsTopic topic);
 extern bool shouldReboot;
 #endif
\ No newline at end of file
@@ -3,5 +3,6 @@
 
 void initWiFi();
 void maintainWiFi();
+extern bool staConnected;   // as last seen by maintainWiFi()
 
 #endif  
\ No newline at end of file
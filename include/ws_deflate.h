@@ -0,0 +1,19 @@
+#ifndef WS_DEFLATE_H
+#define WS_DEFLATE_H
+
+#include <Arduino.h>
+
+#define WS_DEFLATE_MIN_SIZE  512   // smaller frames go out as plain text
+#define WS_DEFLATE_HASH_BITS 10    // 2 KB match table, borrowed from scratchPool
+#define WS_DEFLATE_MAX_DIST  4096  // back-reference window
+
+/*
+Raw DEFLATE (RFC 1951) with one fixed-Huffman block and greedy
+single-probe LZ77 matching. Each message is compressed on its own, so no
+dictionary survives between frames and a session holds no compression
+state. Returns the compressed size, or 0 if the output would not be
+smaller than cap.
+*/
+size_t deflateRaw(const uint8_t* in, size_t len, uint8_t* out, size_t cap);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef WS_TOPICS_H
+#define WS_TOPICS_H
+
+#include <Arduino.h>
+
+enum WsTopic : uint8_t {
+  TOPIC_TEMP,     // temperature, uptime, stats
+  TOPIC_RSSI,
+  TOPIC_GPIO,     // LEDs, relays, PWM
+  TOPIC_OTA,
+  TOPIC_LOG,
+  TOPIC_HUB,      // combined peer snapshots, hub mode only
+  TOPIC_COUNT
+};
+
+// What a client that names no topics gets: the set that existed before
+// topics did. log and hub are opt-in.
+#define TOPIC_LEGACY_MASK ((1 << TOPIC_TEMP) | (1 << TOPIC_RSSI) | (1 << TOPIC_GPIO) | (1 << TOPIC_OTA))
+
+/*
+Use :
+  ws://host:81/?topics=temp:5000,gpio&history=0     subscribe on connect
+  ws://host:81/?deflate=1                           large frames as raw-deflate binary
+  sub rssi:2000                                     text frame, add topics
+  unsub temp                                        text frame, drop topics
+A client that never names topics gets TOPIC_LEGACY_MASK, unthrottled,
+and the history replay, like before; log and hub have to be asked for.
+*/
+void topicsConnected(uint8_t num, const char* url);
+void topicsDisconnected(uint8_t num);
+bool topicsHandleMessage(uint8_t num, const String& msg);
+bool topicsWantsHistory(uint8_t num);
+bool topicsHasSubscribers(WsTopic topic);
+void topicsPublish(WsTopic topic, const String& json);
+bool wsSend(uint8_t num, const String& json);
+bool wsSendPooled(uint8_t num, uint8_t* frame, size_t len);
+uint8_t topicsClientCount();
+String topicsJson();
+
+#endif
\ No newline at end of file
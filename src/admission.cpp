@@ -0,0 +1,186 @@
+#include <Arduino.h>
+#include <WebServer.h>
+#include "esp_heap_caps.h"
+#include "admission.h"
+#include "logger.h"
+#include "web_server.h"
+
+// Everything not listed is ROUTE_LIGHT
+static const struct {
+  const char* route;
+  RouteClass cls;
+} routeClasses[] = {
+  { "/history",       ROUTE_HEAVY },
+  { "/history/stats", ROUTE_HEAVY },
+  { "/file",          ROUTE_HEAVY },
+  { "/partition",     ROUTE_HEAVY },
+  { "/hub/history",   ROUTE_HEAVY },
+  { "/fs_info",       ROUTE_HEAVY },
+  { "/ota_info",      ROUTE_HEAVY },
+  { "/ota_history",   ROUTE_HEAVY },
+  { "/replay",        ROUTE_HEAVY },
+  { "/update",        ROUTE_EXEMPT },
+  { "/trace:upload",  ROUTE_EXEMPT },
+};
+
+struct RateBucket {
+  uint32_t ip;
+  uint32_t milliTokens;
+  uint32_t lastMs;
+};
+
+static RateBucket buckets[RATE_CLIENTS];
+#ifdef ADMISSION_LOAD_TEST
+static uint32_t unlimitUntil = 0;   // millis() the buckets come back on; 0 = on
+#endif
+
+static struct {
+  uint32_t shed;            // 503 under memory pressure
+  uint32_t limited;         // 429 from an empty bucket
+  uint32_t wsRefused;
+  uint32_t historyDeferred;
+  uint32_t historyLate;     // deferred histories sent once memory recovered
+  uint32_t lowestFree;
+  uint32_t lowestBlock;
+  Pressure worst;
+} counts = { 0, 0, 0, 0, 0, UINT32_MAX, UINT32_MAX, PRESSURE_OK };
+
+Pressure memoryPressure() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (freeHeap < counts.lowestFree) counts.lowestFree = freeHeap;
+  if (largest < counts.lowestBlock) counts.lowestBlock = largest;
+
+  Pressure p = PRESSURE_OK;
+  if (freeHeap < ADMIT_CRITICAL_FREE || largest < ADMIT_CRITICAL_BLOCK) p = PRESSURE_CRITICAL;
+  else if (freeHeap < ADMIT_TIGHT_FREE || largest < ADMIT_TIGHT_BLOCK) p = PRESSURE_TIGHT;
+  if (p > counts.worst) counts.worst = p;
+  return p;
+}
+
+RouteClass routeClass(const char* route) {
+  for (const auto& r : routeClasses) {
+    if (strcmp(route, r.route) == 0) return r.cls;
+  }
+  return ROUTE_LIGHT;
+}
+
+// Takes cost tokens from ip's bucket; on failure retryS is how long until it refills enough
+static bool takeTokens(uint32_t ip, uint8_t cost, uint32_t& retryS) {
+  uint32_t now = millis();
+#ifdef ADMISSION_LOAD_TEST
+  if (unlimitUntil) {
+    if ((int32_t)(unlimitUntil - now) > 0) return true;
+    unlimitUntil = 0;
+    LOG_I("Admission: per-IP limits back on");
+  }
+#endif
+  RateBucket* b = nullptr;
+  RateBucket* oldest = &buckets[0];
+  for (auto& e : buckets) {
+    if (e.ip == ip) { b = &e; break; }
+    if (e.ip == 0 || now - e.lastMs > now - oldest->lastMs) oldest = &e;
+    if (e.ip == 0) break;
+  }
+  if (!b) {
+    b = oldest;
+    b->ip = ip;
+    b->milliTokens = RATE_BURST * 1000;
+    b->lastMs = now;
+  }
+
+  uint32_t idle = min<uint32_t>(now - b->lastMs, RATE_BURST * 1000 / RATE_PER_S);
+  b->milliTokens = min<uint32_t>(RATE_BURST * 1000, b->milliTokens + idle * RATE_PER_S);
+  b->lastMs = now;
+
+  uint32_t need = cost * 1000;
+  if (b->milliTokens >= need) {
+    b->milliTokens -= need;
+    return true;
+  }
+  retryS = (need - b->milliTokens) / (RATE_PER_S * 1000) + 1;
+  return false;
+}
+
+bool admitRequest(RouteClass cls) {
+  if (cls == ROUTE_EXEMPT) return true;
+
+  uint32_t retryS;
+  if (!takeTokens(server.client().remoteIP(), cls == ROUTE_HEAVY ? RATE_HEAVY_COST : 1, retryS)) {
+    counts.limited++;
+    server.sendHeader("Retry-After", String(retryS));
+    server.send(429, "text/plain", "Too many requests");
+    return false;
+  }
+
+  if (cls == ROUTE_HEAVY && memoryPressure() != PRESSURE_OK) {
+    counts.shed++;
+    server.sendHeader("Retry-After", String(ADMIT_RETRY_S));
+    server.send(503, "text/plain", "Low memory, try again shortly");
+    return false;
+  }
+  return true;
+}
+
+bool admitWebSocket(IPAddress ip, uint32_t& retryS) {
+  if (!takeTokens(ip, 1, retryS)) {
+    counts.wsRefused++;
+    return false;
+  }
+  if (memoryPressure() == PRESSURE_CRITICAL) {
+    counts.wsRefused++;
+    retryS = ADMIT_RETRY_S;
+    return false;
+  }
+  return true;
+}
+
+// A new client's history is several KB of String; only build it with room to spare
+bool admitHistory() {
+  return memoryPressure() == PRESSURE_OK;
+}
+
+void admissionHistoryDeferred(bool late) {
+  if (late) counts.historyLate++;
+  else counts.historyDeferred++;
+}
+
+#ifdef ADMISSION_LOAD_TEST
+void admissionUnlimit(uint32_t seconds) {
+  seconds = min<uint32_t>(seconds, RATE_UNLIMIT_MAX_S);
+  unlimitUntil = seconds ? (millis() + seconds * 1000) | 1 : 0;
+  if (seconds) LOG_W("Admission: per-IP limits off for %lu s", (unsigned long)seconds);
+  else LOG_I("Admission: per-IP limits back on");
+}
+#endif
+
+String admissionJson() {
+  static const char* const names[] = { "ok", "tight", "critical" };
+  Pressure p = memoryPressure();
+
+  String json = "{\"pressure\":\"" + String(names[p]) + "\"";
+  json += ",\"worst\":\"" + String(names[counts.worst]) + "\"";
+  json += ",\"free\":" + String(ESP.getFreeHeap());
+  json += ",\"largest\":" + String(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  json += ",\"lowest_free\":" + String(counts.lowestFree);
+  json += ",\"lowest_largest\":" + String(counts.lowestBlock);
+  json += ",\"shed\":" + String(counts.shed);
+  json += ",\"limited\":" + String(counts.limited);
+  json += ",\"ws_refused\":" + String(counts.wsRefused);
+  json += ",\"history_deferred\":" + String(counts.historyDeferred);
+  json += ",\"history_late\":" + String(counts.historyLate);
+#ifdef ADMISSION_LOAD_TEST
+  int32_t unlimitedMs = unlimitUntil ? (int32_t)(unlimitUntil - millis()) : 0;
+  json += ",\"unlimited_s\":" + String(max<int32_t>(unlimitedMs, 0) / 1000);
+#endif
+  json += ",\"clients\":[";
+  bool first = true;
+  for (const auto& b : buckets) {
+    if (b.ip == 0) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "{\"ip\":\"" + IPAddress(b.ip).toString() + "\",\"tokens\":" + String(b.milliTokens / 1000) + "}";
+  }
+  json += "]}";
+  return json;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <Arduino.h>
+#include "boot_profile.h"
+#include "esp_timer.h"
+
+struct BootPhase {
+  const char* name;   // string literal, never copied
+  int64_t atMicros;   // esp_timer time, counted from chip reset
+};
+
+static BootPhase bootPhases[MAX_BOOT_PHASES];
+static uint8_t bootPhaseCount = 0;
+static portMUX_TYPE bootMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Phases are marked from setup() and from the deferred init task, so the
+// slot claim has to be atomic.
+void bootMark(const char* phase) {
+  int64_t now = esp_timer_get_time();
+
+  portENTER_CRITICAL(&bootMux);
+  if (bootPhaseCount < MAX_BOOT_PHASES) {
+    bootPhases[bootPhaseCount].name = phase;
+    bootPhases[bootPhaseCount].atMicros = now;
+    bootPhaseCount++;
+  }
+  portEXIT_CRITICAL(&bootMux);
+}
+
+/*
+Use :
+  [{"phase":"gpio","us":41230},{"phase":"wifi","us":98311}, ...]
+  "us" is the absolute time since reset, so consecutive entries give the
+  cost of each phase and the first entry includes the ROM/bootloader time.
+*/
+String bootProfileJson() {
+  String json = "[";
+  uint8_t count;
+
+  portENTER_CRITICAL(&bootMux);
+  count = bootPhaseCount;
+  portEXIT_CRITICAL(&bootMux);
+
+  for (uint8_t i = 0; i < count; ++i) {
+    if (i > 0) json += ",";
+    json += "{\"phase\":\"" + String(bootPhases[i].name) + "\",\"us\":" + String((uint32_t)bootPhases[i].atMicros) + "}";
+  }
+  json += "]";
+  return json;
+}
@@ -1,28 +1,75 @@
 #include <Arduino.h>
-#include "SPIFFS.h"
 #include "fs_spiffs.h"
+#include "logger.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+
+static uint8_t chunk[FS_CHUNK_SIZE];
+static SemaphoreHandle_t chunkLock;
+static volatile bool mounted;   // set by the mount task once begin() has returned
+static int64_t mountUs;
+static uint64_t bytesRead;
+static uint64_t readUs;
+
+void initSpiffsLock() {
+  chunkLock = xSemaphoreCreateMutex();
+}
 
 void initSpiffs(){
 
-  if(!SPIFFS.begin(true)){
-    Serial.println("An Error has occurred while mounting SPIFFS");
+  int64_t start = esp_timer_get_time();
+  if(!APP_FS.begin(true)){
+    LOG_E("An Error has occurred while mounting " APP_FS_NAME);
     return;
   }
+  mountUs = esp_timer_get_time() - start;
+  mounted = true;
+  LOG_I(APP_FS_NAME " mounted in %lu us", (unsigned long)mountUs);
 }
 
-void printVersion(){
+bool fsMounted() {
+  return mounted;
+}
 
-  File file = SPIFFS.open("/version.txt");
-  if(!file){
-    Serial.println("Failed to open file for reading");
-    return;
+/*
+Use :
+  streamFile("/version.txt", Serial);
+  streamFile("/tempData.csv", server.client());
+  streamFile("/tempData.csv", server.client(), 4096, 1024);   // bytes 4096..5119
+*/
+size_t streamFile(const char* path, Print& out, size_t offset, size_t len) {
+
+  if (!mounted) return 0;
+  File file = APP_FS.open(path);
+  if (!file || file.isDirectory()) return 0;
+  if (offset && !file.seek(offset)) {
+    file.close();
+    return 0;
   }
-  Serial.println("File Content:");
-  while(file.available()){
-    Serial.write(file.read());
+
+  size_t total = 0;
+  int64_t start = esp_timer_get_time();
+  xSemaphoreTake(chunkLock, portMAX_DELAY);
+  size_t n;
+  while (total < len && (n = file.read(chunk, min<size_t>(FS_CHUNK_SIZE, len - total))) > 0) {
+    if (out.write(chunk, n) != n) break;
+    total += n;
   }
-  Serial.println(); 
+  xSemaphoreGive(chunkLock);
   file.close();
+
+  readUs += esp_timer_get_time() - start;
+  bytesRead += total;
+  return total;
+}
+
+void printVersion(){
+
+  Serial.println("File Content:");
+  if (streamFile("/version.txt", Serial) == 0) {
+    LOG_E("Failed to open file for reading");
+  }
+  Serial.println();
 }
 
 /*
@@ -33,15 +80,52 @@ Use :
 String readTextFile(const char* path) {
   
   String content;
-  File file = SPIFFS.open(path);
+  File file = mounted ? APP_FS.open(path) : File();
   if (!file) {
-    Serial.println("Failed to open file");
+    LOG_E("Failed to open %S", String(path));
     return "";
   }
 
-  while (file.available()) {
-    content += (char)file.read();
+  // Size the String once, then copy block-sized reads into it
+  int64_t start = esp_timer_get_time();
+  content.reserve(file.size());
+  xSemaphoreTake(chunkLock, portMAX_DELAY);
+  size_t n;
+  while ((n = file.read(chunk, FS_CHUNK_SIZE)) > 0) {
+    content.concat((const char*)chunk, n);
   }
+  xSemaphoreGive(chunkLock);
   file.close();
+
+  readUs += esp_timer_get_time() - start;
+  bytesRead += content.length();
   return content;
 }
+
+// Reads benchPath end to end into a null sink to measure raw throughput
+static uint32_t benchKBps(const char* benchPath) {
+  struct NullPrint : Print {
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t n) override { return n; }
+  } sink;
+
+  int64_t start = esp_timer_get_time();
+  size_t n = streamFile(benchPath, sink);
+  int64_t us = esp_timer_get_time() - start;
+  return (n > 0 && us > 0) ? (uint32_t)((uint64_t)n * 1000000ULL / 1024 / us) : 0;
+}
+
+String fsInfoJson(const char* benchPath) {
+  String json = "{";
+  json += "\"fs\":\"" APP_FS_NAME "\",";
+  json += "\"mounted\":" + String(mounted ? "true" : "false");
+  if (!mounted) return json + "}";
+  json += ",\"mount_us\":" + String((unsigned long)mountUs) + ",";
+  json += "\"total\":" + String((unsigned long)APP_FS.totalBytes()) + ",";
+  json += "\"used\":" + String((unsigned long)APP_FS.usedBytes()) + ",";
+  json += "\"read_bytes\":" + String((unsigned long)bytesRead) + ",";
+  json += "\"read_us\":" + String((unsigned long)readUs);
+  if (benchPath) json += ",\"bench_kBps\":" + String(benchKBps(benchPath));
+  json += "}";
+  return json;
+}
@@ -6,11 +6,53 @@ bool LED1status = LOW;
 bool LED2status = LOW;
 Preferences prefs;
 
+// Call after loadStates(): the saved level is latched before the pin
+// becomes an output, so a relay that was on stays on through the reboot.
 void initGPIO() {
+  digitalWrite(LED1pin, LED1status);
+  digitalWrite(LED2pin, LED2status);
   pinMode(LED1pin, OUTPUT);
   pinMode(LED2pin, OUTPUT);
 }
 
+// Drives any output; LED1/LED2 also update their tracked state so the
+// next handleClients() pass and the next saveStates() agree with it.
+void setOutput(uint8_t pin, bool on) {
+  if (pin == LED1pin) {
+    LED1status = on;
+  } else if (pin == LED2pin) {
+    LED2status = on;
+  } else {
+    pinMode(pin, OUTPUT);
+  }
+  digitalWrite(pin, on ? HIGH : LOW);
+}
+
+// GPIO6-11 drive the SPI flash and 34-39 are input only; driving either
+// hangs or does nothing, so neither may be handed out as an output.
+bool isOutputPin(long pin) {
+  return pin >= 0 && pin <= 33 && (pin < 6 || pin > 11);
+}
+
+// "led1", "led2" or "gpioN"; returns -1 if unknown or not isOutputPin().
+int parseOutputName(const char* name) {
+  char* end;
+
+  if (strcmp(name, "led1") == 0) return LED1pin;
+  if (strcmp(name, "led2") == 0) return LED2pin;
+  if (strncmp(name, "gpio", 4) == 0 && isdigit((unsigned char)name[4])) {
+    long pin = strtol(name + 4, &end, 10);
+    if (*end == 0 && isOutputPin(pin)) return (int)pin;
+  }
+  return -1;
+}
+
+String outputName(uint8_t pin) {
+  if (pin == LED1pin) return "led1";
+  if (pin == LED2pin) return "led2";
+  return "gpio" + String(pin);
+}
+
 void saveStates() {
   prefs.begin("gpio", false);
   prefs.putBool("led1", LED1status);
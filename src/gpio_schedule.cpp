@@ -0,0 +1,687 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+#include "gpio_schedule.h"
+#include "gpio_control.h"
+#include "web_server.h"
+#include "utilities.h"
+#include "logger.h"
+
+/*
+Hierarchical timer wheel, one tick per SCHEDULE_TICK_MS.
+  level 0: 256 slots x 1 tick        (< 256 ms)
+  level 1:  64 slots x 256 ticks     (< 16.4 s)
+  level 2:  64 slots x 16384 ticks   (< 17.5 min)
+  level 3:  64 slots x 2^20 ticks    (< 18.6 h)
+  level 4:  64 slots x 2^26 ticks    (< 49.7 days)
+Entries live in a fixed pool and are doubly linked by index, so linking
+and unlinking are O(1); idMap finds an entry from its id for cancels.
+Each time level 0 wraps, the current slot of level 1 is re-filed into
+level 0 (and so on upwards), so an entry moves down at most four times
+before it fires.
+
+One bit per slot records which slots hold entries. The timer is
+one-shot, armed for the next tick that has work: the next occupied
+level-0 slot, or the next wrap that cascades an occupied upper slot.
+Finding it reads the 16 bitmap words, whatever the number of entries,
+and the wheel jumps straight there: every slot in between is empty, so
+nothing needs re-filing. A daily schedule costs a handful of cascade
+wakeups a day rather than one per millisecond.
+*/
+#define WHEEL_L0_BITS 8
+#define WHEEL_LN_BITS 6
+#define WHEEL_LEVELS  5
+#define WHEEL_SLOTS   ((1 << WHEEL_L0_BITS) + (WHEEL_LEVELS - 1) * (1 << WHEEL_LN_BITS))
+#define WHEEL_NIL     0xFF
+#define WHEEL_WORDS   (WHEEL_SLOTS / 32)
+#define ID_MAP_SIZE   (2 * MAX_SCHEDULES)   // power of two, at most half full
+#define TICK_MICROS   (SCHEDULE_TICK_MS * 1000LL)
+
+struct ScheduleEntry {
+  uint32_t expires;     // wheel tick
+  uint32_t period;      // ticks, 0 = one-shot
+  uint32_t pulseWidth;  // "off" half of a pulse: intended width in us
+  int64_t dueMicros;    // ideal fire time, for the accuracy figures
+  int64_t pulseStart;   // "off" half of a pulse: when the "on" half fired
+  uint16_t id;
+  uint16_t slot;
+  uint8_t pin;
+  uint8_t action;
+  uint8_t next;
+  uint8_t prev;
+  uint8_t partner;      // pulse: index of the other half while the "on" half is pending
+  int16_t atMinute;     // daily schedule: minutes after local midnight, else -1
+  bool used;
+};
+
+// Compact form kept in NVS so pending work survives a reboot. Daily
+// schedules are restored from atMinute, not from remainingMs, which is
+// stale after any reset that skipped saveSchedules().
+struct __attribute__((packed)) ScheduleRecord {
+  uint8_t pin;
+  uint8_t action;
+  uint16_t id;
+  uint32_t remainingMs;
+  uint32_t periodMs;
+  int16_t atMinute;
+};
+
+// Layout before daily schedules were stored by time of day
+struct __attribute__((packed)) ScheduleRecordV1 {
+  uint8_t pin;
+  uint8_t action;
+  uint16_t id;
+  uint32_t remainingMs;
+  uint32_t periodMs;
+};
+
+#define SCHEDULE_RECORD_VERSION 2
+#define SCHEDULE_PARKED         UINT32_MAX   // remainingMs of a daily schedule still waiting for the clock
+
+struct FiredAction {
+  uint8_t pin;
+  uint8_t action;
+};
+
+static ScheduleEntry entries[MAX_SCHEDULES];
+static uint8_t wheel[WHEEL_SLOTS];
+static uint32_t wheelBusy[WHEEL_WORDS];   // bit per slot, set while the slot is non-empty
+static uint8_t freeList = WHEEL_NIL;
+static uint8_t pendingCount = 0;
+static uint32_t wheelNow = 0;          // next tick to process
+static int64_t wheelBaseMicros = 0;    // esp_timer time of tick 0 of the current wrap
+static uint16_t nextScheduleId = 1;
+
+// Daily schedules restored before SNTP has set the clock; filed into the
+// wheel by handleSchedules() once msUntilTimeOfDay() can place them
+static ScheduleRecord parked[MAX_SCHEDULES];
+static uint8_t parkedCount = 0;
+
+// Open-addressed id -> pool index. A pulse is found through its "off"
+// half, which outlives the "on" one.
+struct IdSlot {
+  uint16_t id;
+  uint8_t e;            // WHEEL_NIL = empty
+};
+static IdSlot idMap[ID_MAP_SIZE];
+static_assert((ID_MAP_SIZE & (ID_MAP_SIZE - 1)) == 0 && ID_MAP_SIZE < WHEEL_NIL, "idMap is masked and indexed by uint8_t");
+
+static esp_timer_handle_t wheelTimer = NULL;
+static bool wheelRunning = false;
+static bool wheelArmed = false;
+static uint32_t wheelArmedTick = 0;
+static portMUX_TYPE wheelMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Set from the esp_timer task, consumed by handleSchedules() in loop()
+static volatile bool schedulesDirty = false;
+static volatile bool outputsChanged = false;
+
+static int32_t lastLateMicros = 0;
+static int32_t maxLateMicros = 0;
+static int32_t lastPulseErrorMicros = 0;
+static int32_t maxPulseErrorMicros = 0;
+
+Preferences prefs_sched;
+
+static uint16_t wheelSlotFor(uint32_t expires) {
+  uint32_t delta = expires - wheelNow;
+
+  if (delta < (1UL << WHEEL_L0_BITS)) return expires & 0xFF;
+
+  for (uint8_t level = 1; level < WHEEL_LEVELS; ++level) {
+    uint8_t shift = WHEEL_L0_BITS + level * WHEEL_LN_BITS;
+    if (level == WHEEL_LEVELS - 1 || delta < (1UL << shift)) {
+      uint8_t index = (expires >> (shift - WHEEL_LN_BITS)) & 0x3F;
+      return (1 << WHEEL_L0_BITS) + (level - 1) * (1 << WHEEL_LN_BITS) + index;
+    }
+  }
+  return 0;
+}
+
+static void wheelLink(uint8_t e) {
+  uint16_t slot = wheelSlotFor(entries[e].expires);
+
+  entries[e].slot = slot;
+  entries[e].prev = WHEEL_NIL;
+  entries[e].next = wheel[slot];
+  if (wheel[slot] != WHEEL_NIL) entries[wheel[slot]].prev = e;
+  wheel[slot] = e;
+  wheelBusy[slot >> 5] |= 1UL << (slot & 31);
+}
+
+static void wheelUnlink(uint8_t e) {
+  ScheduleEntry& en = entries[e];
+
+  if (en.prev != WHEEL_NIL) entries[en.prev].next = en.next;
+  else wheel[en.slot] = en.next;
+  if (en.next != WHEEL_NIL) entries[en.next].prev = en.prev;
+  if (wheel[en.slot] == WHEEL_NIL) wheelBusy[en.slot >> 5] &= ~(1UL << (en.slot & 31));
+}
+
+// Empties a slot and returns its list for the caller to walk
+static uint8_t wheelTake(uint16_t slot) {
+  uint8_t e = wheel[slot];
+  wheel[slot] = WHEEL_NIL;
+  wheelBusy[slot >> 5] &= ~(1UL << (slot & 31));
+  return e;
+}
+
+// First occupied slot in [from, to), or -1
+static int wheelFirstBusy(uint16_t from, uint16_t to) {
+  while (from < to) {
+    uint32_t word = wheelBusy[from >> 5] & (UINT32_MAX << (from & 31));
+    if (word) {
+      uint16_t slot = (from & ~31) + __builtin_ctz(word);
+      return slot < to ? slot : -1;
+    }
+    from = (from & ~31) + 32;
+  }
+  return -1;
+}
+
+// Steps from index `from` of a level of `size` slots starting at `base`
+// to the next occupied one, wrapping around; -1 when the level is empty
+static int wheelStepsToBusy(uint16_t base, uint16_t size, uint16_t from) {
+  int slot = wheelFirstBusy(base + from, base + size);
+  if (slot >= 0) return slot - base - from;
+  slot = wheelFirstBusy(base, base + from);
+  return slot >= 0 ? size - from + slot - base : -1;
+}
+
+// Ticks from wheelNow to the next tick that has work: an occupied level-0
+// slot, or a wrap that cascades an occupied upper slot. wheelMux must be held.
+static uint32_t wheelNextDelta() {
+  uint32_t best = UINT32_MAX;
+  int steps = wheelStepsToBusy(0, 1 << WHEEL_L0_BITS, wheelNow & 0xFF);
+
+  if (steps >= 0) best = steps;
+  for (uint8_t level = 1; level < WHEEL_LEVELS; ++level) {
+    uint8_t shift = WHEEL_L0_BITS + (level - 1) * WHEEL_LN_BITS;
+    uint32_t span = 1UL << shift;
+    uint32_t boundary = (wheelNow + span - 1) & ~(span - 1);   // first wrap at or after wheelNow
+    uint16_t base = (1 << WHEEL_L0_BITS) + (level - 1) * (1 << WHEEL_LN_BITS);
+
+    steps = wheelStepsToBusy(base, 1 << WHEEL_LN_BITS, (boundary >> shift) & 0x3F);
+    if (steps < 0) continue;
+    uint32_t delta = (boundary - wheelNow) + steps * span;
+    if (delta < best) best = delta;
+  }
+  return best;
+}
+
+// Ticks wrap after 49.7 days; the wheel only ever moves forward, so a
+// smaller tick means it wrapped and the base moves on by a full turn
+static void wheelMoveTo(uint32_t tick) {
+  if (tick < wheelNow) wheelBaseMicros += (1LL << 32) * TICK_MICROS;
+  wheelNow = tick;
+}
+
+// esp_timer time of a tick at or after wheelNow
+static int64_t wheelTickMicros(uint32_t tick) {
+  return wheelBaseMicros + ((int64_t)wheelNow + (uint32_t)(tick - wheelNow)) * TICK_MICROS;
+}
+
+// One-shot wakeup for tick `tick`; wheelMux must be held
+static void wheelArm(uint32_t tick, int64_t nowMicros) {
+  int64_t wait = wheelTickMicros(tick) - nowMicros;
+  esp_timer_stop(wheelTimer);
+  esp_timer_start_once(wheelTimer, wait > 0 ? wait : 1);
+  wheelArmed = true;
+  wheelArmedTick = tick;
+}
+
+static uint8_t idFind(uint16_t id) {
+  for (uint8_t i = id & (ID_MAP_SIZE - 1); idMap[i].e != WHEEL_NIL; i = (i + 1) & (ID_MAP_SIZE - 1)) {
+    if (idMap[i].id == id) return i;
+  }
+  return WHEEL_NIL;
+}
+
+static uint8_t idLookup(uint16_t id) {
+  uint8_t i = idFind(id);
+  return i == WHEEL_NIL ? WHEEL_NIL : idMap[i].e;
+}
+
+static void idPut(uint16_t id, uint8_t e) {
+  uint8_t i = idFind(id);
+  if (i == WHEEL_NIL) {
+    for (i = id & (ID_MAP_SIZE - 1); idMap[i].e != WHEEL_NIL; i = (i + 1) & (ID_MAP_SIZE - 1)) {}
+  }
+  idMap[i].id = id;
+  idMap[i].e = e;
+}
+
+// Removes id and shifts later members of its probe run back over the hole
+static void idErase(uint16_t id) {
+  uint8_t hole = idFind(id);
+  if (hole == WHEEL_NIL) return;
+
+  for (uint8_t i = (hole + 1) & (ID_MAP_SIZE - 1); idMap[i].e != WHEEL_NIL; i = (i + 1) & (ID_MAP_SIZE - 1)) {
+    uint8_t home = idMap[i].id & (ID_MAP_SIZE - 1);
+    // Movable unless its home lies cyclically in (hole, i]
+    if (((i - home) & (ID_MAP_SIZE - 1)) >= ((i - hole) & (ID_MAP_SIZE - 1))) {
+      idMap[hole] = idMap[i];
+      hole = i;
+    }
+  }
+  idMap[hole].e = WHEEL_NIL;
+}
+
+static void wheelRelease(uint8_t e) {
+  if (idLookup(entries[e].id) == e) idErase(entries[e].id);
+  entries[e].used = false;
+  entries[e].next = freeList;
+  freeList = e;
+  pendingCount--;
+}
+
+// Re-files the current slot of an upper level; returns true when that
+// level wrapped too, so the caller carries on to the next one.
+static bool wheelCascade(uint8_t level) {
+  uint8_t shift = WHEEL_L0_BITS + (level - 1) * WHEEL_LN_BITS;
+  uint8_t index = (wheelNow >> shift) & 0x3F;
+  uint16_t slot = (1 << WHEEL_L0_BITS) + (level - 1) * (1 << WHEEL_LN_BITS) + index;
+  uint8_t e = wheelTake(slot);
+
+  while (e != WHEEL_NIL) {
+    uint8_t next = entries[e].next;
+    wheelLink(e);
+    e = next;
+  }
+  return index == 0;
+}
+
+// Processes tick wheelNow with wheelMux held. The GPIO work is handed
+// back to the caller so it runs outside the critical section.
+static uint8_t wheelAdvance(int64_t nowMicros, FiredAction* fired) {
+  uint8_t count = 0;
+
+  if ((wheelNow & 0xFF) == 0) {
+    for (uint8_t level = 1; level < WHEEL_LEVELS && wheelCascade(level); ++level) {}
+  }
+
+  uint8_t e = wheelTake(wheelNow & 0xFF);
+
+  while (e != WHEEL_NIL) {
+    ScheduleEntry& en = entries[e];
+    uint8_t next = en.next;
+
+    if (en.expires != wheelNow) {
+      wheelLink(e);
+      e = next;
+      continue;
+    }
+
+    lastLateMicros = (int32_t)(nowMicros - en.dueMicros);
+    if (lastLateMicros > maxLateMicros) maxLateMicros = lastLateMicros;
+
+    if (en.partner != WHEEL_NIL && !en.pulseWidth) {
+      entries[en.partner].pulseStart = nowMicros;
+      entries[en.partner].partner = WHEEL_NIL;
+    } else if (en.pulseWidth && en.pulseStart) {
+      lastPulseErrorMicros = (int32_t)(nowMicros - en.pulseStart - en.pulseWidth);
+      if (abs(lastPulseErrorMicros) > maxPulseErrorMicros) maxPulseErrorMicros = abs(lastPulseErrorMicros);
+    }
+
+    fired[count].pin = en.pin;
+    fired[count].action = en.action;
+    count++;
+
+    if (en.period) {
+      en.expires += en.period;
+      en.dueMicros += (int64_t)en.period * TICK_MICROS;
+      wheelLink(e);
+    } else {
+      wheelRelease(e);
+      schedulesDirty = true;
+    }
+    e = next;
+  }
+
+  wheelMoveTo(wheelNow + 1);
+  return count;
+}
+
+static void applyAction(const FiredAction& f) {
+  bool level;
+
+  if (f.action == SCHED_ACTION_TOGGLE) {
+    if (f.pin == LED1pin) level = !LED1status;
+    else if (f.pin == LED2pin) level = !LED2status;
+    else level = !digitalRead(f.pin);
+  } else {
+    level = f.action == SCHED_ACTION_ON;
+  }
+  setOutput(f.pin, level);
+  if (f.pin == LED1pin || f.pin == LED2pin) outputsChanged = true;
+}
+
+// Runs in the esp_timer task. Ticks are derived from the clock rather
+// than counted, so a delayed callback catches up instead of drifting;
+// every tick that is due is processed, then the timer is re-armed.
+static void wheelTimerCallback(void* arg) {
+  FiredAction fired[MAX_SCHEDULES];
+
+  for (;;) {
+    int64_t now = esp_timer_get_time();
+    uint32_t current = (uint32_t)((now - wheelBaseMicros) / TICK_MICROS);
+    uint8_t count;
+
+    portENTER_CRITICAL(&wheelMux);
+    wheelArmed = false;
+    if (pendingCount == 0) {
+      wheelRunning = false;
+      portEXIT_CRITICAL(&wheelMux);
+      return;
+    }
+    uint32_t delta = wheelNextDelta();
+    if ((int64_t)delta + (int32_t)(wheelNow - current) > 0) {
+      wheelArm(wheelNow + delta, now);
+      portEXIT_CRITICAL(&wheelMux);
+      return;
+    }
+    wheelMoveTo(wheelNow + delta);    // every slot in between is empty
+    count = wheelAdvance(now, fired);
+    portEXIT_CRITICAL(&wheelMux);
+
+    for (uint8_t i = 0; i < count; ++i) applyAction(fired[i]);
+  }
+}
+
+// Links a new entry and brings the wakeup forward if it needs attention
+// sooner; wheelMux must be held.
+// Returns the pool index.
+static int wheelInsert(uint8_t pin, uint8_t action, uint32_t delayMs, uint32_t periodMs, uint16_t id,
+                       int16_t atMinute = -1) {
+  int64_t now = esp_timer_get_time();
+  uint32_t ticks = (delayMs + SCHEDULE_TICK_MS - 1) / SCHEDULE_TICK_MS;
+  uint8_t e = freeList;
+
+  if (e == WHEEL_NIL) return -1;
+
+  if (!wheelRunning) {
+    // Resume the tick count where it stopped so stored expiries stay valid
+    wheelBaseMicros = now - (int64_t)wheelNow * TICK_MICROS;
+    wheelRunning = true;
+  }
+
+  uint32_t current = (uint32_t)((now - wheelBaseMicros) / TICK_MICROS);
+  if ((int32_t)(current + 1 - wheelNow) < 0) current = wheelNow - 1;   // last processed tick at the latest
+
+  freeList = entries[e].next;
+  pendingCount++;
+
+  ScheduleEntry& en = entries[e];
+  en.used = true;
+  en.id = id;
+  en.pin = pin;
+  en.action = action;
+  en.partner = WHEEL_NIL;
+  en.atMinute = atMinute;
+  en.pulseWidth = 0;
+  en.pulseStart = 0;
+  en.period = (periodMs + SCHEDULE_TICK_MS - 1) / SCHEDULE_TICK_MS;
+  en.expires = current + (ticks ? ticks : 1);
+  en.dueMicros = wheelTickMicros(en.expires);
+  wheelLink(e);
+  idPut(id, e);
+
+  uint32_t delta = wheelNextDelta();
+  if (!wheelArmed || delta < wheelArmedTick - wheelNow) wheelArm(wheelNow + delta, now);
+  return e;
+}
+
+// Fires every day at hour:minute local time. Before SNTP has synced the
+// entry waits in parked[] and is filed once the clock is known.
+int addDailySchedule(uint8_t pin, uint8_t action, uint8_t hour, uint8_t minute) {
+  bool ok = false;
+  uint16_t id;
+
+  if (hour > 23 || minute > 59) return -1;
+  int16_t atMinute = hour * 60 + minute;
+  long delayMs = msUntilTimeOfDay(hour, minute);
+
+  portENTER_CRITICAL(&wheelMux);
+  id = nextScheduleId++;
+  if (delayMs >= 0) {
+    ok = wheelInsert(pin, action, delayMs, SCHEDULE_DAY_MS, id, atMinute) >= 0;
+  } else if (pendingCount + parkedCount < MAX_SCHEDULES) {
+    parked[parkedCount++] = { pin, action, id, SCHEDULE_PARKED, SCHEDULE_DAY_MS, atMinute };
+    ok = true;
+  }
+  portEXIT_CRITICAL(&wheelMux);
+
+  if (!ok) return -1;
+  schedulesDirty = true;
+  return id;
+}
+
+int addSchedule(uint8_t pin, uint8_t action, uint32_t delayMs, uint32_t periodMs) {
+  int e;
+  uint16_t id;
+
+  portENTER_CRITICAL(&wheelMux);
+  id = nextScheduleId++;
+  e = wheelInsert(pin, action, delayMs, periodMs, id);
+  portEXIT_CRITICAL(&wheelMux);
+
+  if (e < 0) return -1;
+  schedulesDirty = true;
+  return id;
+}
+
+// Both edges come off the same wheel, so the width is only subject to
+// the tick jitter, not to when the request happened to arrive.
+int addPulse(uint8_t pin, uint32_t delayMs, uint32_t widthMs) {
+  int on, off = -1;
+  uint16_t id;
+
+  if (widthMs == 0) return -1;
+
+  portENTER_CRITICAL(&wheelMux);
+  id = nextScheduleId++;
+  on = wheelInsert(pin, SCHED_ACTION_ON, delayMs, 0, id);
+  if (on >= 0) {
+    off = wheelInsert(pin, SCHED_ACTION_OFF, (delayMs ? delayMs : SCHEDULE_TICK_MS) + widthMs, 0, id);
+    if (off < 0) {
+      wheelUnlink(on);
+      wheelRelease(on);
+    } else {
+      entries[on].partner = off;
+      entries[off].partner = on;
+      entries[off].pulseWidth = widthMs * 1000;
+    }
+  }
+  portEXIT_CRITICAL(&wheelMux);
+
+  if (off < 0) return -1;
+  schedulesDirty = true;
+  return id;
+}
+
+// Re-links the halves of a pulse restored from NVS; wheelMux must be held
+static void pairPulse(uint8_t a, uint8_t b) {
+  uint8_t on = (int32_t)(entries[b].expires - entries[a].expires) < 0 ? b : a;
+  uint8_t off = on == a ? b : a;
+
+  entries[on].partner = off;
+  entries[off].partner = on;
+  entries[off].pulseWidth = (entries[off].expires - entries[on].expires) * TICK_MICROS;
+  idPut(entries[off].id, off);
+}
+
+bool cancelSchedule(uint16_t id) {
+  bool found = false;
+
+  portENTER_CRITICAL(&wheelMux);
+  uint8_t e = idLookup(id);
+  if (e != WHEEL_NIL) {
+    uint8_t partner = entries[e].partner;
+    if (partner != WHEEL_NIL) {
+      wheelUnlink(partner);
+      wheelRelease(partner);
+    }
+    wheelUnlink(e);
+    wheelRelease(e);
+    found = true;
+  }
+  // Parked entries are not in the wheel and only exist until SNTP syncs
+  for (uint8_t i = 0; i < parkedCount; ++i) {
+    if (parked[i].id == id) {
+      parked[i--] = parked[--parkedCount];
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&wheelMux);
+
+  if (found) schedulesDirty = true;
+  return found;
+}
+
+static uint8_t snapshotSchedules(ScheduleRecord* out) {
+  uint8_t count = 0;
+  int64_t now = esp_timer_get_time();
+
+  portENTER_CRITICAL(&wheelMux);
+  for (uint8_t e = 0; e < MAX_SCHEDULES; ++e) {
+    const ScheduleEntry& en = entries[e];
+    if (!en.used) continue;
+
+    int64_t remaining = (en.dueMicros - now) / 1000;
+    out[count].pin = en.pin;
+    out[count].action = en.action;
+    out[count].id = en.id;
+    out[count].remainingMs = remaining > 0 ? (uint32_t)remaining : 0;
+    out[count].periodMs = en.period * SCHEDULE_TICK_MS;
+    out[count].atMinute = en.atMinute;
+    count++;
+  }
+  for (uint8_t i = 0; i < parkedCount; ++i) out[count++] = parked[i];
+  portEXIT_CRITICAL(&wheelMux);
+  return count;
+}
+
+void saveSchedules() {
+  ScheduleRecord records[MAX_SCHEDULES];
+  uint8_t count = snapshotSchedules(records);
+
+  prefs_sched.begin("sched", false);
+  prefs_sched.putBytes("list", records, count * sizeof(ScheduleRecord));
+  prefs_sched.putUChar("ver", SCHEDULE_RECORD_VERSION);
+  prefs_sched.putUShort("nextId", nextScheduleId);
+  prefs_sched.end();
+  schedulesDirty = false;
+}
+
+void initSchedules() {
+  ScheduleRecord records[MAX_SCHEDULES];
+  esp_timer_create_args_t args = {};
+  size_t len;
+
+  memset(wheel, WHEEL_NIL, sizeof(wheel));
+  memset(wheelBusy, 0, sizeof(wheelBusy));
+  for (uint8_t i = 0; i < ID_MAP_SIZE; ++i) idMap[i].e = WHEEL_NIL;
+  for (uint8_t e = 0; e < MAX_SCHEDULES; ++e) {
+    entries[e].used = false;
+    entries[e].next = (e + 1 < MAX_SCHEDULES) ? e + 1 : WHEEL_NIL;
+  }
+  freeList = 0;
+
+  args.callback = wheelTimerCallback;
+  args.name = "gpioWheel";
+  esp_timer_create(&args, &wheelTimer);
+
+  prefs_sched.begin("sched", true);
+  uint8_t version = prefs_sched.getUChar("ver", 1);
+  len = prefs_sched.getBytesLength("list");
+  if (version == SCHEDULE_RECORD_VERSION) {
+    if (len > sizeof(records)) len = sizeof(records);
+    len = prefs_sched.getBytes("list", records, len) / sizeof(ScheduleRecord);
+  } else {
+    ScheduleRecordV1 old[MAX_SCHEDULES];
+    if (len > sizeof(old)) len = sizeof(old);
+    len = prefs_sched.getBytes("list", old, len) / sizeof(ScheduleRecordV1);
+    for (size_t i = 0; i < len; ++i) {
+      records[i] = { old[i].pin, old[i].action, old[i].id, old[i].remainingMs, old[i].periodMs, -1 };
+    }
+  }
+  nextScheduleId = prefs_sched.getUShort("nextId", 1);
+  prefs_sched.end();
+
+  // Remaining times are as of the last save, which planned reboots do
+  // first; daily ones are re-aimed at their time of day, or parked until
+  // the clock is set
+  portENTER_CRITICAL(&wheelMux);
+  for (size_t i = 0; i < len; ++i) {
+    const ScheduleRecord& r = records[i];
+    if (r.atMinute < 0) {
+      // The second record of an id is the other half of a pulse
+      uint8_t twin = idLookup(r.id);
+      int e = wheelInsert(r.pin, r.action, r.remainingMs, r.periodMs, r.id);
+      if (e >= 0 && twin != WHEEL_NIL) pairPulse(twin, e);
+      continue;
+    }
+    long delayMs = msUntilTimeOfDay(r.atMinute / 60, r.atMinute % 60);
+    if (delayMs >= 0) wheelInsert(r.pin, r.action, delayMs, r.periodMs, r.id, r.atMinute);
+    else {
+      parked[parkedCount] = r;
+      parked[parkedCount++].remainingMs = SCHEDULE_PARKED;
+    }
+  }
+  portEXIT_CRITICAL(&wheelMux);
+
+  LOG_I("Restored %u schedules, %u waiting for the clock", (unsigned)len, (unsigned)parkedCount);
+}
+
+// Files parked daily schedules once SNTP has set the wall clock
+static void unparkSchedules() {
+  if (parkedCount == 0 || msUntilTimeOfDay(0, 0) < 0) return;
+
+  portENTER_CRITICAL(&wheelMux);
+  while (parkedCount) {
+    const ScheduleRecord& r = parked[--parkedCount];
+    long delayMs = msUntilTimeOfDay(r.atMinute / 60, r.atMinute % 60);
+    if (wheelInsert(r.pin, r.action, delayMs, r.periodMs, r.id, r.atMinute) < 0) {
+      parkedCount++;    // table full; try again on a later pass
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&wheelMux);
+  schedulesDirty = true;
+}
+
+void handleSchedules() {
+  unparkSchedules();
+  if (outputsChanged) {
+    outputsChanged = false;
+    saveStates();
+    broadcastEvent("{\"led1\":" + String(LED1status ? "true" : "false") + ",\"led2\":" + String(LED2status ? "true" : "false") + "}", TOPIC_GPIO);
+  }
+  if (schedulesDirty) saveSchedules();
+}
+
+String schedulesJson() {
+  ScheduleRecord records[MAX_SCHEDULES];
+  uint8_t count = snapshotSchedules(records);
+  String json = "{";
+
+  json += "\"late_us\":" + String(lastLateMicros) + ",\"late_max_us\":" + String(maxLateMicros) + ",";
+  json += "\"pulse_error_us\":" + String(lastPulseErrorMicros) + ",\"pulse_error_max_us\":" + String(maxPulseErrorMicros) + ",";
+  json += "\"schedules\":[";
+  for (uint8_t i = 0; i < count; ++i) {
+    static const char* actionNames[] = {"off", "on", "toggle"};
+    if (i > 0) json += ",";
+    json += "{\"id\":" + String(records[i].id);
+    json += ",\"pin\":\"" + outputName(records[i].pin) + "\"";
+    json += ",\"action\":\"" + String(actionNames[records[i].action]) + "\"";
+    if (records[i].atMinute >= 0) {
+      char at[6];
+      snprintf(at, sizeof(at), "%02d:%02d", records[i].atMinute / 60, records[i].atMinute % 60);
+      json += ",\"at\":\"" + String(at) + "\"";
+    }
+    json += ",\"in_ms\":" + (records[i].remainingMs == SCHEDULE_PARKED ? String("null") : String(records[i].remainingMs));
+    json += ",\"every_ms\":" + String(records[i].periodMs) + "}";
+  }
+  json += "]}";
+  return json;
+}
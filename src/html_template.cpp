@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include "html_template.h"
+
+// Chunked transfer: one chunk per literal segment, straight from flash,
+// and one per resolved placeholder.
+void streamTemplate(WebServer& server, const char* contentType, const TemplateSegment* segs, size_t count, TemplateResolver resolve, void* ctx, TemplateStats* stats) {
+  char value[TPL_VAR_SIZE];
+  uint32_t start = micros();
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, contentType, "");
+  if (stats) {
+    stats->firstByteUs = micros() - start;
+    stats->minFreeHeap = ESP.getFreeHeap();
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const TemplateSegment& seg = segs[i];
+    if (seg.text) {
+      server.sendContent_P(seg.text, seg.len);
+    } else {
+      size_t n = min(resolve(seg.var, value, sizeof(value), ctx), sizeof(value));
+      if (n > 0) server.sendContent(value, n);
+    }
+    if (stats) stats->minFreeHeap = min(stats->minFreeHeap, ESP.getFreeHeap());
+  }
+  server.sendContent("");
+  if (stats) stats->totalUs = micros() - start;
+}
+
+// Whole page in one String, for callers that still need it that way
+String renderTemplate(const TemplateSegment* segs, size_t count, TemplateResolver resolve, void* ctx) {
+  char value[TPL_VAR_SIZE];
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i) total += segs[i].text ? segs[i].len : sizeof(value);
+
+  String out;
+  out.reserve(total);
+  for (size_t i = 0; i < count; ++i) {
+    const TemplateSegment& seg = segs[i];
+    if (seg.text) {
+      out.concat(seg.text, seg.len);
+    } else {
+      size_t n = min(resolve(seg.var, value, sizeof(value), ctx), sizeof(value));
+      out.concat(value, n);
+    }
+  }
+  return out;
+}
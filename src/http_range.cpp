@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include "http_range.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "logger.h"
+
+static const char* const appLabels[] = { "factory", "ota_0", "ota_1" };
+
+static struct {
+  uint32_t full;            // 200, whole body
+  uint32_t partial;         // 206
+  uint32_t unsatisfiable;   // 416
+  uint32_t ignored;         // Range present but not honoured
+  uint64_t partitionBytes;
+  uint64_t partitionUs;
+} rs;
+
+enum RangeResult : uint8_t { RANGE_NONE, RANGE_PARTIAL, RANGE_UNSATISFIABLE };
+
+// "bytes=first-last", "bytes=first-" or "bytes=-suffix"; anything else is ignored
+static RangeResult parseRange(const String& header, size_t size, size_t& offset, size_t& len) {
+  if (!header.startsWith("bytes=") || header.indexOf(',') >= 0) return RANGE_NONE;
+  int dash = header.indexOf('-');
+  if (dash < 6) return RANGE_NONE;
+
+  String first = header.substring(6, dash);
+  String last = header.substring(dash + 1);
+  first.trim();
+  last.trim();
+  for (size_t i = 0; i < first.length(); ++i) if (!isDigit(first[i])) return RANGE_NONE;
+  for (size_t i = 0; i < last.length(); ++i) if (!isDigit(last[i])) return RANGE_NONE;
+
+  if (first.length() == 0) {
+    if (last.length() == 0) return RANGE_NONE;
+    size_t suffix = strtoul(last.c_str(), nullptr, 10);
+    if (suffix == 0 || size == 0) return RANGE_UNSATISFIABLE;
+    len = min<size_t>(suffix, size);
+    offset = size - len;
+    return RANGE_PARTIAL;
+  }
+
+  size_t start = strtoul(first.c_str(), nullptr, 10);
+  size_t end = last.length() ? strtoul(last.c_str(), nullptr, 10) : size - 1;
+  if (last.length() && end < start) return RANGE_NONE;
+  if (start >= size) return RANGE_UNSATISFIABLE;
+  offset = start;
+  len = min<size_t>(end, size - 1) - start + 1;
+  return RANGE_PARTIAL;
+}
+
+void initRangeHeaders(WebServer& server) {
+  static const char* headers[] = { "Range", "If-Range" };
+  server.collectHeaders(headers, 2);
+}
+
+// Sends status and headers; false means a 416 already went out and there is no body
+bool beginRangeResponse(WebServer& server, size_t size, const String& type, const String& etag,
+                        size_t& offset, size_t& len) {
+  offset = 0;
+  len = size;
+  server.sendHeader("Accept-Ranges", "bytes");
+  if (etag.length()) server.sendHeader("ETag", etag);
+
+  RangeResult result = RANGE_NONE;
+  String range = server.header("Range");
+  if (range.length()) {
+    // If-Range names the version the client already holds part of; a mismatch means start over
+    String ifRange = server.header("If-Range");
+    if (ifRange.length() == 0 || (etag.length() && ifRange == etag)) {
+      result = parseRange(range, size, offset, len);
+    }
+    if (result == RANGE_NONE) rs.ignored++;
+  }
+
+  if (result == RANGE_UNSATISFIABLE) {
+    rs.unsatisfiable++;
+    server.sendHeader("Content-Range", "bytes */" + String(size));
+    server.send(416, "text/plain", "Range not satisfiable");
+    return false;
+  }
+
+  int code = 200;
+  if (result == RANGE_PARTIAL) {
+    code = 206;
+    rs.partial++;
+    server.sendHeader("Content-Range", "bytes " + String(offset) + "-" + String(offset + len - 1) + "/" + String(size));
+  } else {
+    offset = 0;
+    len = size;
+    rs.full++;
+  }
+  server.setContentLength(len);
+  server.send(code, type, "");
+  return true;
+}
+
+const esp_partition_t* findAppPartition(const String& label) {
+  for (const char* name : appLabels) {
+    if (label == name) return esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, name);
+  }
+  return nullptr;
+}
+
+// From the image's own ELF hash, so it changes exactly when the partition is reflashed
+String partitionEtag(const esp_partition_t* part) {
+  esp_app_desc_t desc;
+  if (esp_ota_get_partition_description(part, &desc) != ESP_OK) return "";
+  char tag[19];
+  tag[0] = '"';
+  for (uint8_t i = 0; i < 8; ++i) snprintf(tag + 1 + i * 2, 3, "%02x", desc.app_elf_sha256[i]);
+  tag[17] = '"';
+  tag[18] = '\0';
+  return tag;
+}
+
+static size_t copyPartition(const esp_partition_t* part, Print& out, size_t offset, size_t len, void (*between)()) {
+  size_t pos = offset;
+  size_t end = offset + len;
+  bool ok = true;
+  while (ok && pos < end) {
+    size_t window = pos & ~(size_t)(RANGE_WINDOW_SIZE - 1);
+    size_t windowLen = min<size_t>(RANGE_WINDOW_SIZE, part->size - window);
+    const void* mapped;
+    spi_flash_mmap_handle_t handle;
+    if (esp_partition_mmap(part, window, windowLen, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+      LOG_W("Partition %s: cannot map 0x%x", part->label, (unsigned)window);
+      break;
+    }
+
+    // Sector-aligned writes, so a resumed range falls back into step after one short write
+    size_t windowEnd = min<size_t>(window + windowLen, end);
+    while (pos < windowEnd) {
+      size_t n = min<size_t>(RANGE_SLICE_SIZE - pos % RANGE_SLICE_SIZE, windowEnd - pos);
+      if (out.write((const uint8_t*)mapped + (pos - window), n) != n) {
+        ok = false;
+        break;
+      }
+      pos += n;
+    }
+    spi_flash_munmap(handle);
+    if (ok && between) between();
+  }
+  return pos - offset;
+}
+
+size_t streamPartition(const esp_partition_t* part, Print& out, size_t offset, size_t len, void (*between)()) {
+  if (!part || offset >= part->size) return 0;
+  len = min<size_t>(len, part->size - offset);
+
+  int64_t start = esp_timer_get_time();
+  size_t n = copyPartition(part, out, offset, len, between);
+  rs.partitionBytes += n;
+  rs.partitionUs += esp_timer_get_time() - start;
+  return n;
+}
+
+// Maps and reads a whole partition into a null sink: flash speed without the network
+static uint32_t benchKBps(const esp_partition_t* part) {
+  struct NullPrint : Print {
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t n) override { return n; }
+  } sink;
+
+  int64_t start = esp_timer_get_time();
+  size_t n = copyPartition(part, sink, 0, part->size, nullptr);
+  int64_t us = esp_timer_get_time() - start;
+  return (n > 0 && us > 0) ? (uint32_t)((uint64_t)n * 1000000ULL / 1024 / us) : 0;
+}
+
+String partitionsJson(const String& benchLabel) {
+  String json = "{\"partitions\":[";
+  bool first = true;
+  for (const char* name : appLabels) {
+    const esp_partition_t* part = findAppPartition(name);
+    if (!part) continue;
+    if (!first) json += ",";
+    first = false;
+    String etag = partitionEtag(part);
+    etag.replace("\"", "");
+    json += "{\"label\":\"" + String(part->label) + "\"";
+    json += ",\"address\":" + String(part->address);
+    json += ",\"size\":" + String(part->size);
+    json += ",\"etag\":\"" + etag + "\"";
+    if (benchLabel == name) json += ",\"bench_kBps\":" + String(benchKBps(part));
+    json += "}";
+  }
+  uint32_t ms = rs.partitionUs / 1000;
+  json += "],\"responses\":{\"full\":" + String(rs.full);
+  json += ",\"partial\":" + String(rs.partial);
+  json += ",\"unsatisfiable\":" + String(rs.unsatisfiable);
+  json += ",\"range_ignored\":" + String(rs.ignored);
+  json += "},\"streamed_bytes\":" + String((uint32_t)rs.partitionBytes);
+  json += ",\"streamed_ms\":" + String(ms);
+  json += ",\"streamed_kBps\":" + String(ms ? (uint32_t)(rs.partitionBytes / ms * 1000 / 1024) : 0);
+  json += "}";
+  return json;
+}
@@ -0,0 +1,350 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
+#include "hub.h"
+#include "temperature.h"
+#include "gpio_control.h"
+#include "link_monitor.h"
+#include "ws_topics.h"
+#include "utilities.h"
+#include "logger.h"
+
+extern unsigned long bootMillis;
+
+#define HUB_RX_PER_STEP   8       // datagrams handled per hubStep(), the rest wait for the next pass
+#define HUB_SLOTS         (HUB_MAX_PEERS + 1)
+
+static_assert(sizeof(HubBeaconBody) >= sizeof(HubSnapshotBody) &&
+              sizeof(HubBeaconBody) >= sizeof(HubRequestBody), "beacon is the largest body");
+
+// One slot per board, all allocated up front; slot 0 is this board
+struct HubPeer {
+  bool used;
+  uint8_t mac[6];
+  uint32_t ip;
+  uint16_t port;
+  char name[HUB_NAME_LEN + 1];
+  uint8_t flags;
+  uint32_t lastSeenMs;        // beacon or reply
+  uint32_t lastReplyMs;
+  uint32_t answeredRound;
+  uint32_t requests;
+  uint32_t replies;
+  HubSnapshotBody snap;
+  int16_t history[HUB_HISTORY];
+  uint8_t histHead;           // next write
+  uint8_t histLen;
+};
+
+static HubConfig cfg;
+static WiFiUDP udp;
+Preferences prefs_hub;
+
+static HubPeer peers[HUB_SLOTS];
+static uint8_t selfMac[6];
+static uint32_t hubRound = 0;
+static uint32_t roundStartMs = 0;
+static uint32_t lastBeaconMs = 0;
+static bool beaconed = false;
+
+static struct {
+  uint32_t rx;
+  uint32_t rxBad;             // short, wrong magic or version
+  uint32_t tx;
+  uint32_t txFailed;
+  uint32_t rejected;          // beacons from new boards while every slot was taken
+  uint32_t evicted;
+} st;
+
+/* ========== Wire ========== */
+
+static void sendPacket(IPAddress ip, uint16_t port, HubKind kind, const void* body, size_t len) {
+  uint8_t buf[sizeof(HubHeader) + sizeof(HubBeaconBody)];
+  HubHeader& h = *(HubHeader*)buf;
+  h.magic = HUB_MAGIC;
+  h.version = HUB_VERSION;
+  h.kind = kind;
+  memcpy(h.mac, selfMac, sizeof(h.mac));
+  memcpy(buf + sizeof(HubHeader), body, len);
+
+  size_t total = sizeof(HubHeader) + len;
+  if (udp.beginPacket(ip, port) && udp.write(buf, total) == total && udp.endPacket()) st.tx++;
+  else st.txFailed++;
+}
+
+static void snapshotSelf(HubSnapshotBody& s) {
+  s.uptimeS = getUptimeMillis(bootMillis) / 1000;
+  s.heapFree = ESP.getFreeHeap();
+  s.tempCenti = (int16_t)lroundf(currentTempC * 100);
+  s.rssi = linkRssi();
+  s.clients = linkApClients();
+  s.flags = (LED1status ? HUB_FLAG_LED1 : 0) | (LED2status ? HUB_FLAG_LED2 : 0) | (cfg.enabled ? HUB_FLAG_HUB : 0);
+}
+
+static void sendBeacon() {
+  HubBeaconBody b;
+  memset(&b, 0, sizeof(b));
+  strncpy(b.name, peers[0].name, sizeof(b.name));
+  b.flags = cfg.enabled ? HUB_FLAG_HUB : 0;
+  sendPacket(WiFi.broadcastIP(), HUB_PORT, HUB_BEACON, &b, sizeof(b));
+}
+
+/* ========== Peers ========== */
+
+static HubPeer* findPeer(const uint8_t* mac, bool create) {
+  HubPeer* freeSlot = nullptr;
+  for (uint8_t i = 1; i < HUB_SLOTS; ++i) {
+    if (peers[i].used && memcmp(peers[i].mac, mac, 6) == 0) return &peers[i];
+    if (!peers[i].used && !freeSlot) freeSlot = &peers[i];
+  }
+  if (!create) return nullptr;
+  if (!freeSlot) {
+    st.rejected++;
+    return nullptr;
+  }
+  memset(freeSlot, 0, sizeof(HubPeer));
+  freeSlot->used = true;
+  memcpy(freeSlot->mac, mac, 6);
+  return freeSlot;
+}
+
+// Beacons are unauthenticated and the name ends up in JSON and on the hub
+// page, so only [A-Za-z0-9_-] is kept; anything else becomes '_'
+static void copyPeerName(char* dst, const char* src) {
+  uint8_t i = 0;
+  for (; i < HUB_NAME_LEN && src[i]; ++i) {
+    char c = src[i];
+    dst[i] = isAlphaNumeric(c) || c == '_' || c == '-' ? c : '_';
+  }
+  if (i == 0) dst[i++] = '?';
+  dst[i] = '\0';
+}
+
+static void pushHistory(HubPeer& p, int16_t v) {
+  p.history[p.histHead] = v;
+  p.histHead = (p.histHead + 1) % HUB_HISTORY;
+  if (p.histLen < HUB_HISTORY) p.histLen++;
+}
+
+static void onPacket(const uint8_t* buf, size_t len) {
+  const HubHeader& h = *(const HubHeader*)buf;
+  if (len < sizeof(HubHeader) || h.magic != HUB_MAGIC || h.version != HUB_VERSION) {
+    st.rxBad++;
+    return;
+  }
+  if (memcmp(h.mac, selfMac, 6) == 0) return;     // our own broadcast looping back
+  const uint8_t* body = buf + sizeof(HubHeader);
+  size_t bodyLen = len - sizeof(HubHeader);
+  uint32_t now = millis();
+
+  if (h.kind == HUB_BEACON && cfg.enabled && bodyLen >= sizeof(HubBeaconBody)) {
+    HubPeer* p = findPeer(h.mac, true);
+    if (!p) return;
+    const HubBeaconBody& b = *(const HubBeaconBody*)body;
+    bool isNew = p->name[0] == '\0';
+    copyPeerName(p->name, b.name);
+    if (isNew) LOG_I("Hub: found %s at %I", p->name, udp.remoteIP());
+    p->flags = b.flags;
+    p->ip = (uint32_t)udp.remoteIP();
+    p->port = udp.remotePort();
+    p->lastSeenMs = now;
+  } else if (h.kind == HUB_REQUEST && cfg.beacon && bodyLen >= sizeof(HubRequestBody)) {
+    HubSnapshotBody s;
+    snapshotSelf(s);
+    s.round = ((const HubRequestBody*)body)->round;
+    sendPacket(udp.remoteIP(), udp.remotePort(), HUB_SNAPSHOT, &s, sizeof(s));
+  } else if (h.kind == HUB_SNAPSHOT && cfg.enabled && bodyLen >= sizeof(HubSnapshotBody)) {
+    HubPeer* p = findPeer(h.mac, false);
+    if (!p) return;
+    memcpy(&p->snap, body, sizeof(HubSnapshotBody));
+    p->answeredRound = p->snap.round;
+    p->replies++;
+    p->lastReplyMs = now;
+    p->lastSeenMs = now;
+  }
+}
+
+/* ========== Rounds ========== */
+
+static void peerId(const HubPeer& p, char out[13]) {
+  snprintf(out, 13, "%02x%02x%02x%02x%02x%02x", p.mac[0], p.mac[1], p.mac[2], p.mac[3], p.mac[4], p.mac[5]);
+}
+
+static String peerJson(const HubPeer& p, uint32_t now) {
+  char id[13];
+  peerId(p, id);
+  bool fresh = &p == &peers[0] || p.answeredRound == hubRound;
+  String json = "{\"id\":\"" + String(id) + "\"";
+  json += ",\"name\":\"" + String(p.name) + "\"";
+  json += ",\"ip\":\"" + (&p == &peers[0] ? WiFi.localIP() : IPAddress(p.ip)).toString() + "\"";
+  json += ",\"temp\":" + (p.lastReplyMs || &p == &peers[0] ? String(p.snap.tempCenti / 100.0, 2) : String("null"));
+  json += ",\"fresh\":" + String(fresh ? "true" : "false");
+  json += ",\"rssi\":" + String(p.snap.rssi);
+  json += ",\"clients\":" + String(p.snap.clients);
+  json += ",\"uptime\":" + String(p.snap.uptimeS);
+  json += ",\"heap\":" + String(p.snap.heapFree);
+  json += ",\"led1\":" + String(p.snap.flags & HUB_FLAG_LED1 ? "true" : "false");
+  json += ",\"led2\":" + String(p.snap.flags & HUB_FLAG_LED2 ? "true" : "false");
+  json += ",\"age_ms\":" + String(&p == &peers[0] ? 0 : now - p.lastReplyMs);
+  json += "}";
+  return json;
+}
+
+// A history point for every slot, then the combined frame for WebSocket subscribers
+static void closeRound(uint32_t now) {
+  snapshotSelf(peers[0].snap);
+  peers[0].lastReplyMs = now;
+  for (uint8_t i = 0; i < HUB_SLOTS; ++i) {
+    HubPeer& p = peers[i];
+    if (!p.used) continue;
+    pushHistory(p, i == 0 || p.answeredRound == hubRound ? p.snap.tempCenti : HUB_MISSING);
+  }
+
+  if (!topicsHasSubscribers(TOPIC_HUB)) return;
+  String json = "{\"hub\":{\"round\":" + String(hubRound) + ",\"peers\":[";
+  for (uint8_t i = 0; i < HUB_SLOTS; ++i) {
+    if (!peers[i].used) continue;
+    if (i > 0) json += ",";
+    json += peerJson(peers[i], now);
+  }
+  json += "]}}";
+  topicsPublish(TOPIC_HUB, json);
+}
+
+// Drops boards that went quiet, then asks everyone left for a snapshot
+static void openRound(uint32_t now) {
+  hubRound++;
+  roundStartMs = now;
+  for (uint8_t i = 1; i < HUB_SLOTS; ++i) {
+    HubPeer& p = peers[i];
+    if (!p.used) continue;
+    if (now - p.lastSeenMs > HUB_PEER_TIMEOUT_MS) {
+      LOG_I("Hub: lost %s", p.name);
+      p.used = false;
+      st.evicted++;
+      continue;
+    }
+    HubRequestBody r = { hubRound };
+    sendPacket(IPAddress(p.ip), p.port, HUB_REQUEST, &r, sizeof(r));
+    p.requests++;
+  }
+}
+
+// Loop job: drain what arrived, beacon, and run a round when one is due
+void hubStep() {
+  if ((!cfg.enabled && !cfg.beacon) || !linkStaUp()) return;
+
+  uint8_t buf[sizeof(HubHeader) + sizeof(HubBeaconBody)];
+  for (uint8_t i = 0; i < HUB_RX_PER_STEP; ++i) {
+    int len = udp.parsePacket();
+    if (len <= 0) break;
+    st.rx++;
+    int n = udp.read(buf, sizeof(buf));
+    if (n > 0) onPacket(buf, n);
+  }
+
+  uint32_t now = millis();
+  if (cfg.beacon && (!beaconed || now - lastBeaconMs >= HUB_BEACON_MS)) {
+    beaconed = true;
+    lastBeaconMs = now;
+    sendBeacon();
+  }
+  if (cfg.enabled && now - roundStartMs >= cfg.intervalMs) {
+    if (hubRound) closeRound(now);
+    openRound(now);
+  }
+}
+
+/* ========== Settings ========== */
+
+static void saveHubConfig() {
+  prefs_hub.begin("hub", false);
+  prefs_hub.putBytes("cfg", &cfg, sizeof(cfg));
+  prefs_hub.end();
+}
+
+// After initWiFi(), which the board's identity needs for the MAC
+void initHub() {
+  prefs_hub.begin("hub", true);
+  size_t len = prefs_hub.getBytes("cfg", &cfg, sizeof(cfg));
+  prefs_hub.end();
+
+  if (len != sizeof(cfg)) {
+    cfg.intervalMs = HUB_DEFAULT_INTERVAL_MS;
+    cfg.enabled = 0;
+    cfg.beacon = 1;
+  }
+
+  WiFi.macAddress(selfMac);
+  HubPeer& self = peers[0];
+  self.used = true;
+  memcpy(self.mac, selfMac, sizeof(selfMac));
+  snprintf(self.name, sizeof(self.name), "%s-%02x%02x%02x", DEVICE_NAME, selfMac[3], selfMac[4], selfMac[5]);
+
+  udp.begin(HUB_PORT);
+}
+
+// Interval 0, enable -1 and beacon -1 each keep the current setting
+bool hubConfigure(uint32_t intervalMs, int8_t enable, int8_t beacon) {
+  if (intervalMs && intervalMs < HUB_MIN_INTERVAL_MS) return false;
+
+  if (intervalMs) cfg.intervalMs = intervalMs;
+  if (beacon >= 0) cfg.beacon = beacon;
+  if (enable >= 0 && enable != cfg.enabled) {
+    cfg.enabled = enable;
+    for (uint8_t i = 1; i < HUB_SLOTS; ++i) peers[i].used = false;
+    peers[0].histLen = 0;
+    peers[0].histHead = 0;
+    hubRound = 0;
+  }
+  saveHubConfig();
+  LOG_I("Hub %s, beacon %s, %lu ms rounds", cfg.enabled ? "on" : "off", cfg.beacon ? "on" : "off",
+        (unsigned long)cfg.intervalMs);
+  return true;
+}
+
+String hubJson() {
+  uint32_t now = millis();
+  uint8_t count = 0;
+  String json = "{\"enabled\":" + String(cfg.enabled ? "true" : "false");
+  json += ",\"beacon\":" + String(cfg.beacon ? "true" : "false");
+  json += ",\"interval_ms\":" + String(cfg.intervalMs);
+  json += ",\"round\":" + String(hubRound);
+  json += ",\"peers\":[";
+  for (uint8_t i = 0; i < HUB_SLOTS; ++i) {
+    if (!peers[i].used) continue;
+    if (count++) json += ",";
+    json += peerJson(peers[i], now);
+  }
+  json += "],\"max_peers\":" + String(HUB_MAX_PEERS);
+  json += ",\"ram_bytes\":" + String(sizeof(peers));
+  json += ",\"rx\":" + String(st.rx);
+  json += ",\"rx_bad\":" + String(st.rxBad);
+  json += ",\"tx\":" + String(st.tx);
+  json += ",\"tx_failed\":" + String(st.txFailed);
+  json += ",\"rejected\":" + String(st.rejected);
+  json += ",\"evicted\":" + String(st.evicted);
+  json += "}";
+  return json;
+}
+
+// Empty for a free slot; oldest point first, null for rounds the peer missed
+String hubHistoryJson(uint8_t slot) {
+  if (slot >= HUB_SLOTS || !peers[slot].used) return "";
+  const HubPeer& p = peers[slot];
+  char id[13];
+  peerId(p, id);
+
+  String json;
+  json.reserve(32 + p.histLen * 7);
+  json = "{\"id\":\"" + String(id) + "\",\"history\":[";
+  uint8_t start = (p.histHead + HUB_HISTORY - p.histLen) % HUB_HISTORY;
+  for (uint8_t i = 0; i < p.histLen; ++i) {
+    int16_t v = p.history[(start + i) % HUB_HISTORY];
+    if (i > 0) json += ",";
+    json += v == HUB_MISSING ? String("null") : String(v / 100.0, 2);
+  }
+  json += "]}";
+  return json;
+}
@@ -0,0 +1,222 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "esp_wifi.h"
+#include "link_monitor.h"
+#include "web_server.h"
+#include "logger.h"
+
+// Written from the Wi-Fi event task, read from the loop
+static volatile bool staUp = false;
+static volatile bool stationsDirty = true;
+static volatile uint8_t lastReason = 0;
+static volatile uint32_t staConnects = 0;
+static volatile uint32_t staDrops = 0;
+static volatile uint32_t apJoins = 0;
+static volatile uint32_t apLeaves = 0;
+
+static float rssiAvg = 0;
+static int8_t rssiRaw = 0;
+static bool rssiSeeded = false;
+static uint32_t lastSampleMs = 0;
+static uint32_t lastStationMs = 0;
+
+static LinkStation stations[LINK_MAX_STATIONS];
+static uint8_t stationCount = 0;
+
+static int8_t sentRssi = 0;
+static int16_t sentClients = -1;
+
+// One per cached answer, each against the driver call it replaced
+enum LinkRead : uint8_t {
+  READ_STA,         // linkStaUp(), was WiFi.status()
+  READ_RSSI,        // linkRssi(), was WiFi.RSSI()
+  READ_STATIONS,    // linkApClients(), was WiFi.softAPgetStationNum()
+  READ_KINDS
+};
+
+static struct {
+  uint32_t driverCalls;
+  uint32_t driverUs;
+  uint32_t cachedReads;       // answers that used to be a driver call each
+} reads[READ_KINDS];
+
+static struct {
+  uint32_t rssiSamples;
+  uint32_t stationRefreshes;
+} st;
+
+static void driverTimed(LinkRead kind, uint32_t t0) {
+  reads[kind].driverUs += micros() - t0;
+  reads[kind].driverCalls++;
+}
+
+// Event task context: flags and counters only, the loop job does the rest
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      staUp = true;
+      staConnects++;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      if (staUp) staDrops++;
+      staUp = false;
+      lastReason = info.wifi_sta_disconnected.reason;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      staUp = false;
+      break;
+    case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
+      apJoins++;
+      stationsDirty = true;
+      break;
+    case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
+      apLeaves++;
+      stationsDirty = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void initLinkMonitor() {
+  WiFi.onEvent(onWiFiEvent);
+}
+
+static void sampleRssi() {
+  uint32_t t0 = micros();
+  int8_t raw = WiFi.RSSI();
+  driverTimed(READ_RSSI, t0);
+  if (raw == 0) return;       // association dropped between the event and now
+
+  rssiRaw = raw;
+  if (!rssiSeeded) {
+    rssiAvg = raw;
+    rssiSeeded = true;
+  } else {
+    rssiAvg += (raw - rssiAvg) * LINK_EWMA_ALPHA;
+  }
+  st.rssiSamples++;
+}
+
+static void refreshStations() {
+  wifi_sta_list_t list;
+  uint32_t t0 = micros();
+  esp_err_t err = esp_wifi_ap_get_sta_list(&list);
+  driverTimed(READ_STATIONS, t0);
+  if (err != ESP_OK) return;
+
+  stationCount = min<int>(list.num, LINK_MAX_STATIONS);
+  for (uint8_t i = 0; i < stationCount; ++i) {
+    memcpy(stations[i].mac, list.sta[i].mac, sizeof(stations[i].mac));
+    stations[i].rssi = list.sta[i].rssi;
+  }
+  st.stationRefreshes++;
+}
+
+// Dashboards hear about RSSI only when the smoothed value moved, and
+// about the client count whenever it changes
+static void announce() {
+  String json;
+  int8_t rssi = rssiSeeded ? (int8_t)lroundf(rssiAvg) : 0;
+  if (staUp && rssiSeeded && abs(rssi - sentRssi) >= LINK_RSSI_STEP) {
+    sentRssi = rssi;
+    json += "\"rssi\":" + String(rssi);
+  }
+  if (stationCount != sentClients) {
+    sentClients = stationCount;
+    if (json.length()) json += ",";
+    json += "\"clients\":" + String(stationCount);
+  }
+  if (json.length()) broadcastEvent("{" + json + "}", TOPIC_RSSI);
+}
+
+// Loop job
+void linkStep() {
+  uint32_t now = millis();
+
+  if (staUp) {
+    if (!rssiSeeded || now - lastSampleMs >= LINK_SAMPLE_MS) {
+      lastSampleMs = now;
+      sampleRssi();
+    }
+  } else if (rssiSeeded) {
+    rssiSeeded = false;       // next association starts its own average
+    rssiRaw = 0;
+    sentRssi = 0;
+  }
+
+  if (stationsDirty || now - lastStationMs >= LINK_STATION_MS) {
+    stationsDirty = false;
+    lastStationMs = now;
+    refreshStations();
+  }
+
+  // Once per boot, after the first association: the one status poll that
+  // gives linkStaUp() reads a cost of their own to be weighed against
+  if (staUp && reads[READ_STA].driverCalls == 0) {
+    uint32_t t0 = micros();
+    WiFi.status();
+    driverTimed(READ_STA, t0);
+  }
+
+  announce();
+}
+
+bool linkStaUp() {
+  reads[READ_STA].cachedReads++;
+  return staUp;
+}
+
+int8_t linkRssi() {
+  reads[READ_RSSI].cachedReads++;
+  return rssiSeeded ? (int8_t)lroundf(rssiAvg) : 0;
+}
+
+uint8_t linkApClients() {
+  reads[READ_STATIONS].cachedReads++;
+  return stationCount;
+}
+
+// {"calls":..,"us":..,"avg_us":..,"cached_reads":..,"saved_ms_est":..} for one kind
+static String readJson(LinkRead kind, uint32_t& savedMs) {
+  const auto& r = reads[kind];
+  uint32_t avgUs = r.driverCalls ? r.driverUs / r.driverCalls : 0;
+  uint32_t saved = (uint64_t)r.cachedReads * avgUs / 1000;
+  savedMs += saved;
+  return "{\"calls\":" + String(r.driverCalls) +
+         ",\"us\":" + String(r.driverUs) +
+         ",\"avg_us\":" + String(avgUs) +
+         ",\"cached_reads\":" + String(r.cachedReads) +
+         ",\"saved_ms_est\":" + String(saved) + "}";
+}
+
+String linkJson() {
+  String json = "{\"sta\":{\"up\":" + String(staUp ? "true" : "false");
+  json += ",\"rssi\":" + String(rssiSeeded ? (int)lroundf(rssiAvg) : 0);
+  json += ",\"rssi_raw\":" + String(rssiRaw);
+  json += ",\"samples\":" + String(st.rssiSamples);
+  json += ",\"connects\":" + String(staConnects);
+  json += ",\"drops\":" + String(staDrops);
+  json += ",\"last_reason\":" + String(lastReason);
+  json += "},\"ap\":{\"clients\":" + String(stationCount);
+  json += ",\"joins\":" + String(apJoins);
+  json += ",\"leaves\":" + String(apLeaves);
+  json += ",\"refreshes\":" + String(st.stationRefreshes);
+  json += ",\"stations\":[";
+  for (uint8_t i = 0; i < stationCount; ++i) {
+    char mac[18];
+    const uint8_t* m = stations[i].mac;
+    snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x", m[0], m[1], m[2], m[3], m[4], m[5]);
+    if (i > 0) json += ",";
+    json += "{\"mac\":\"" + String(mac) + "\",\"rssi\":" + String(stations[i].rssi) + "}";
+  }
+  // Each cached read stood in for a driver call of its own kind, costing
+  // about that kind's avg_us
+  uint32_t savedMs = 0;
+  json += "]},\"driver\":{\"sta\":" + readJson(READ_STA, savedMs);
+  json += ",\"rssi\":" + readJson(READ_RSSI, savedMs);
+  json += ",\"stations\":" + readJson(READ_STATIONS, savedMs);
+  json += ",\"saved_ms_est\":" + String(savedMs);
+  json += "}}";
+  return json;
+}
@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/semphr.h"
+#include "logger.h"
+
+// Bounded multi-producer ring: each slot carries a sequence number, so a
+// producer claims a slot with one compare-and-swap and never blocks. When
+// the ring is full the record is dropped and counted instead.
+struct LogSlot {
+  std::atomic<uint32_t> seq;
+  LogRecord rec;
+};
+
+struct LogRing {
+  LogSlot slots[LOG_RING_SIZE];
+  std::atomic<uint32_t> writePos;
+  uint32_t readPos;
+  std::atomic<uint32_t> dropped;
+
+  LogRing() : writePos(0), readPos(0), dropped(0) {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; ++i) slots[i].seq.store(i);
+  }
+};
+
+static LogRing logRing;
+
+static char logTail[LOG_TAIL_SIZE];
+static size_t logTailHead = 0;
+static size_t logTailLen = 0;
+static uint32_t logTailTotal = 0;   // bytes ever appended, the cursor space for logsSince()
+static SemaphoreHandle_t logTailLock = NULL;
+
+void logPush(const LogRecord& rec) {
+  uint32_t pos = logRing.writePos.load(std::memory_order_relaxed);
+
+  for (;;) {
+    LogSlot& slot = logRing.slots[pos & (LOG_RING_SIZE - 1)];
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+
+    if (diff == 0) {
+      if (logRing.writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot.rec = rec;
+        slot.seq.store(pos + 1, std::memory_order_release);
+        return;
+      }
+    } else if (diff < 0) {
+      logRing.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = logRing.writePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+static bool logPop(LogRecord& out) {
+  LogSlot& slot = logRing.slots[logRing.readPos & (LOG_RING_SIZE - 1)];
+  uint32_t seq = slot.seq.load(std::memory_order_acquire);
+
+  if ((int32_t)(seq - (logRing.readPos + 1)) < 0) return false;
+
+  out = slot.rec;
+  slot.seq.store(logRing.readPos + LOG_RING_SIZE, std::memory_order_release);
+  logRing.readPos++;
+  return true;
+}
+
+// Expands the deferred record. Each conversion is handed to snprintf on
+// its own with the argument word cast back to the type its letter implies.
+static size_t logFormat(const LogRecord& rec, char* out, size_t cap) {
+  static const char levelTags[] = "-EWID";
+  size_t len = snprintf(out, cap, "[%lu.%03lu] %c ", (unsigned long)(rec.ms / 1000), (unsigned long)(rec.ms % 1000), levelTags[rec.level]);
+  const char* p = rec.fmt;
+  uint8_t argi = 0;
+
+  while (*p && len < cap - 1) {
+    if (*p != '%') {
+      out[len++] = *p++;
+      continue;
+    }
+
+    char spec[12];
+    size_t sl = 0;
+    spec[sl++] = *p++;
+    while (*p && strchr("-+ #0123456789.lh", *p) && sl < sizeof(spec) - 2) spec[sl++] = *p++;
+    char conv = *p ? *p++ : '%';
+    bool isLong = memchr(spec, 'l', sl) != NULL;
+    uint32_t arg = (conv != '%' && argi < rec.nargs) ? rec.args[argi++] : 0;
+    size_t room = cap - len;
+    int n;
+
+    spec[sl++] = conv;
+    spec[sl] = 0;
+
+    switch (conv) {
+      case 'd': case 'i':
+        n = isLong ? snprintf(out + len, room, spec, (long)(int32_t)arg) : snprintf(out + len, room, spec, (int)arg);
+        break;
+      case 'u': case 'x': case 'X':
+        n = isLong ? snprintf(out + len, room, spec, (unsigned long)arg) : snprintf(out + len, room, spec, (unsigned)arg);
+        break;
+      case 'c':
+        n = snprintf(out + len, room, spec, (int)arg);
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+        float f;
+        memcpy(&f, &arg, sizeof(f));
+        n = snprintf(out + len, room, spec, (double)f);
+        break;
+      }
+      case 's':
+        n = snprintf(out + len, room, spec, arg ? (const char*)(uintptr_t)arg : "(null)");
+        break;
+      case 'S':
+        n = snprintf(out + len, room, "%s", rec.str);
+        break;
+      case 'I':
+        n = snprintf(out + len, room, "%u.%u.%u.%u", (unsigned)(arg & 0xff), (unsigned)((arg >> 8) & 0xff), (unsigned)((arg >> 16) & 0xff), (unsigned)(arg >> 24));
+        break;
+      default:
+        n = snprintf(out + len, room, "%%");
+        break;
+    }
+    if (n > 0) len += ((size_t)n < room) ? (size_t)n : room - 1;
+  }
+
+  if (len > cap - 2) len = cap - 2;
+  out[len++] = '\n';
+  out[len] = 0;
+  return len;
+}
+
+static void logTailAppend(const char* line, size_t len) {
+  xSemaphoreTake(logTailLock, portMAX_DELAY);
+  for (size_t i = 0; i < len; ++i) {
+    logTail[(logTailHead + logTailLen) % LOG_TAIL_SIZE] = line[i];
+    if (logTailLen < LOG_TAIL_SIZE) {
+      logTailLen++;
+    } else {
+      logTailHead = (logTailHead + 1) % LOG_TAIL_SIZE;
+    }
+  }
+  logTailTotal += len;
+  xSemaphoreGive(logTailLock);
+}
+
+static void logDrainTask(void* arg) {
+  LogRecord rec;
+  char line[160];
+  uint32_t lastDropped = 0;
+
+  for (;;) {
+    bool idle = true;
+
+    while (logPop(rec)) {
+      size_t len = logFormat(rec, line, sizeof(line));
+      Serial.write((const uint8_t*)line, len);
+      logTailAppend(line, len);
+      idle = false;
+    }
+
+    uint32_t dropped = logRing.dropped.load(std::memory_order_relaxed);
+    if (dropped != lastDropped) {
+      size_t len = snprintf(line, sizeof(line), "[log] %lu records dropped\n", (unsigned long)(dropped - lastDropped));
+      Serial.write((const uint8_t*)line, len);
+      lastDropped = dropped;
+    }
+
+    if (idle) vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+
+// Records pushed before this runs stay queued and are printed once the
+// drain task starts. It runs on core 0: at priority 1 on loop()'s core it
+// would time-slice with loopTask whenever a burst of records is queued.
+void initLogger() {
+  logTailLock = xSemaphoreCreateMutex();
+  xTaskCreatePinnedToCore(logDrainTask, "logDrain", 3072, NULL, tskIDLE_PRIORITY + 1, NULL, 0);
+}
+
+String recentLogs() {
+  String out;
+  if (!logTailLock) return out;
+
+  out.reserve(LOG_TAIL_SIZE);
+  xSemaphoreTake(logTailLock, portMAX_DELAY);
+  size_t first = logTailLen < LOG_TAIL_SIZE - logTailHead ? logTailLen : LOG_TAIL_SIZE - logTailHead;
+  out.concat(logTail + logTailHead, first);
+  out.concat(logTail, logTailLen - first);
+  xSemaphoreGive(logTailLock);
+  return out;
+}
+
+// Text appended since the caller's cursor, clipped to what the tail still
+// holds; the cursor is advanced to the end.
+String logsSince(uint32_t& cursor) {
+  String out;
+  if (!logTailLock) return out;
+
+  xSemaphoreTake(logTailLock, portMAX_DELAY);
+  uint32_t fresh = logTailTotal - cursor;
+  if (fresh > logTailLen) fresh = logTailLen;
+  out.reserve(fresh);
+  for (size_t i = logTailLen - fresh; i < logTailLen; ++i) {
+    out.concat(logTail[(logTailHead + i) % LOG_TAIL_SIZE]);
+  }
+  cursor = logTailTotal;
+  xSemaphoreGive(logTailLock);
+  return out;
+}
+
+uint32_t logDroppedCount() {
+  return logRing.dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include "loop_scheduler.h"
+#include "metrics.h"
+#include "supervisor.h"
+
+static LoopJob jobs[MAX_LOOP_JOBS];
+static uint8_t jobCount = 0;
+static uint8_t lowCursor = 0;
+static int8_t passMetric = -1;
+static uint32_t maxPassUs = 0;
+
+/*
+Use :
+  addLoopJob("temp", updateTemperature, 1000, JOB_NORMAL, 2000);
+Registration order is the run order within a priority.
+*/
+int8_t addLoopJob(const char* name, JobFn fn, uint32_t periodMs, JobPriority prio, uint32_t budgetUs) {
+  if (jobCount >= MAX_LOOP_JOBS) return -1;
+  if (passMetric < 0) passMetric = metricsRegister("loop:pass");
+
+  LoopJob& j = jobs[jobCount];
+  memset(&j, 0, sizeof(j));
+  j.name = name;
+  j.fn = fn;
+  j.periodMs = periodMs;
+  j.prio = prio;
+  j.budgetUs = budgetUs;
+  j.nextDue = millis();
+  j.metric = metricsRegister(name);
+  return jobCount++;
+}
+
+static bool isDue(const LoopJob& j, uint32_t now) {
+  return (int32_t)(now - j.nextDue) >= 0;
+}
+
+// Timed work above `prio` waiting to run; every-pass jobs don't count,
+// they get their turn at the top of the next pass anyway.
+static bool higherDue(JobPriority prio, uint32_t now) {
+  for (uint8_t i = 0; i < jobCount; ++i) {
+    if (jobs[i].prio < prio && jobs[i].periodMs > 0 && isDue(jobs[i], now)) return true;
+  }
+  return false;
+}
+
+static void runJob(LoopJob& j) {
+  uint32_t now = millis();
+  uint32_t late = now - j.nextDue;
+  if (j.periodMs > 0) {
+    if (late > j.maxLateMs) j.maxLateMs = late;
+    if (late >= j.periodMs) j.misses++;
+    // Keep the cadence, but don't try to catch up on missed periods
+    j.nextDue = late >= j.periodMs ? now + j.periodMs : j.nextDue + j.periodMs;
+  }
+
+  uint32_t start = micros();
+  const char* prev = superEnter(j.name);
+  j.fn();
+  superLeave(prev);
+  uint32_t took = micros() - start;
+
+  j.runs++;
+  if (took > j.maxRunUs) j.maxRunUs = took;
+  if (j.budgetUs && took > j.budgetUs) j.overruns++;
+  metricsRecord(j.metric, took);
+}
+
+// One pass: high, then normal, then a single low job if the coast is clear
+void runLoopJobs() {
+  uint32_t passStart = micros();
+
+  for (uint8_t prio = JOB_HIGH; prio < JOB_LOW; ++prio) {
+    for (uint8_t i = 0; i < jobCount; ++i) {
+      LoopJob& j = jobs[i];
+      if (j.prio == prio && (j.periodMs == 0 || isDue(j, millis()))) runJob(j);
+    }
+  }
+
+  for (uint8_t n = 0; n < jobCount; ++n) {
+    uint8_t i = (lowCursor + n) % jobCount;
+    LoopJob& j = jobs[i];
+    if (j.prio != JOB_LOW || (j.periodMs > 0 && !isDue(j, millis()))) continue;
+
+    if (higherDue(JOB_LOW, millis())) {
+      j.yields++;
+      break;
+    }
+    runJob(j);
+    lowCursor = i + 1;
+    break;
+  }
+
+  uint32_t passUs = micros() - passStart;
+  if (passUs > maxPassUs) maxPassUs = passUs;
+  metricsRecord(passMetric, passUs);
+}
+
+String loopJobsJson() {
+  String json = "{\"max_pass_us\":" + String(maxPassUs) + ",\"jobs\":[";
+  for (uint8_t i = 0; i < jobCount; ++i) {
+    const LoopJob& j = jobs[i];
+    if (i > 0) json += ",";
+    json += "{\"name\":\"" + String(j.name) + "\"";
+    json += ",\"prio\":" + String(j.prio);
+    json += ",\"period_ms\":" + String(j.periodMs);
+    json += ",\"budget_us\":" + String(j.budgetUs);
+    json += ",\"runs\":" + String(j.runs);
+    json += ",\"overruns\":" + String(j.overruns);
+    json += ",\"misses\":" + String(j.misses);
+    json += ",\"yields\":" + String(j.yields);
+    json += ",\"max_run_us\":" + String(j.maxRunUs);
+    json += ",\"max_late_ms\":" + String(j.maxLateMs) + "}";
+  }
+  json += "]}";
+  return json;
+}
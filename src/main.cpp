@@ -16,34 +16,92 @@
 #include "temperature.h"
 #include "wifi_setup.h"
 #include "utilities.h"
+#include "boot_profile.h"
+#include "logger.h"
+#include "rules.h"
+#include "gpio_schedule.h"
+#include "pwm_control.h"
+#include "warm_restart.h"
+#include "loop_scheduler.h"
+#include "supervisor.h"
+#include "trace_replay.h"
+#include "udp_export.h"
+#include "mqtt_client.h"
+#include "mem_pool.h"
+#include "link_monitor.h"
+#include "hub.h"
 #include "esp_ota_ops.h"
 #include "esp_partition.h"
 
 unsigned long bootMillis;
 
+// Nothing here is needed to answer the first HTTP request, so it runs on a
+// low-priority task while setup() brings the network up.
+static void deferredInitTask(void* arg) {
+  initSpiffs();
+  bootMark("spiffs");
+  printVersion();
+  bootMark("version");
+  vTaskDelete(NULL);
+}
+
 void setup() {
 
   bootMillis = millis();
 
-  Serial.begin(115200);
-  initSpiffs();
-  printVersion();
+  // Restore relay state before anything else so outputs never glitch.
+  // A planned restart hands it over in RTC memory; otherwise read NVS.
+  if (!warmRestore()) loadStates();
   initGPIO();
+  initPWM();
+  bootMark("gpio");
+  initRules();
+  initSchedules();
+  initUdpExport();
+
+  Serial.begin(115200);
+  initLogger();
+  initPools();   // before WiFi and the servers start carving up the heap
+  initLinkMonitor();
   initWiFi();
+  bootMark("wifi");
+  initMqtt();
+  initHub();
   initWebServer();
-  initWebSocket();
-  loadStates();
   handleOtaUpdate();
+  bootMark("http");
+  initWebSocket();
+  bootMark("websocket");
+
+  initSpiffsLock();
+  xTaskCreate(deferredInitTask, "deferredInit", 4096, NULL, 1, NULL);
+
+  // Budgets are per run in microseconds; an overrun is counted, not cut short
+  addLoopJob("job:http", handleClients, 0, JOB_HIGH, 5000);
+  addLoopJob("job:gpio_sched", handleSchedules, 0, JOB_HIGH, 2000);
+  addLoopJob("job:temp", updateTemperature, 1000, JOB_NORMAL, 2000);
+  addLoopJob("job:push", pushTelemetry, 1000, JOB_NORMAL, 3000);
+  addLoopJob("job:wifi", maintainWiFi, 500, JOB_LOW, 2000);
+  addLoopJob("job:link", linkStep, 500, JOB_LOW, 1000);
+  addLoopJob("job:logs", pushLogs, 500, JOB_LOW, 2000);
+  addLoopJob("job:mqtt", mqttStep, 100, JOB_LOW, 5000);
+  addLoopJob("job:udp", udpExportStep, 250, JOB_LOW, 2000);
+  addLoopJob("job:hub", hubStep, 50, JOB_LOW, 3000);
+  addLoopJob("job:replay", replayStep, 0, JOB_LOW, REPLAY_SLICE_US + 5000);
+
+  // Last, so a slow boot is never mistaken for a stalled loop
+  initSupervisor();
 }
 
 void loop() {
 
-  handleClients();
-  updateTemperature();
-  maintainWiFi();
+  superBeat(HB_LOOP);
+  runLoopJobs();
 
   if (shouldReboot) {
-    Serial.println("OTA update complete. Rebooting...");
+    LOG_I("OTA update complete. Rebooting...");
+    saveSchedules();
+    warmSave();
     delay(1000);
     ESP.restart();
   }
@@ -0,0 +1,70 @@
+#include <Arduino.h>
+#include "mem_pool.h"
+#include "ws_topics.h"
+#include "logger.h"
+
+FixedPool framePool;
+FixedPool scratchPool;
+
+bool FixedPool::begin(const char* poolName, size_t blockSize, uint8_t blocks) {
+  if (blocks == 0 || blocks > 32) return false;
+  name = poolName;
+  size = (blockSize + 3) & ~(size_t)3;    // keep every block word aligned
+  base = (uint8_t*)malloc(size * blocks);
+  if (!base) {
+    LOG_E("Pool %s: %u x %u B unavailable", name, (unsigned)blocks, (unsigned)size);
+    return false;
+  }
+  count = blocks;
+  freeMask = blocks == 32 ? 0xFFFFFFFFu : (1u << blocks) - 1;
+  return true;
+}
+
+void* FixedPool::take() {
+  if (freeMask == 0) {
+    misses++;
+    return nullptr;
+  }
+  uint8_t i = __builtin_ctz(freeMask);
+  freeMask &= ~(1u << i);
+  takes++;
+  if (++used > peak) peak = used;
+  return base + i * size;
+}
+
+void FixedPool::give(void* block) {
+  if (!block) return;
+  uint8_t* p = (uint8_t*)block;
+  size_t offset = p - base;
+  if (p < base || offset >= size * count || offset % size || (freeMask & (1u << (offset / size)))) {
+    LOG_E("Pool %s: bad or double give", name);
+    return;
+  }
+  uint8_t i = offset / size;
+  freeMask |= 1u << i;
+  used--;
+}
+
+String FixedPool::json() const {
+  return "{\"block\":" + String(size) +
+         ",\"blocks\":" + String(count) +
+         ",\"used\":" + String(used) +
+         ",\"peak\":" + String(peak) +
+         ",\"takes\":" + String(takes) +
+         ",\"misses\":" + String(misses) + "}";
+}
+
+// Early in setup(), while the heap is still one piece
+void initPools() {
+  framePool.begin("frame", POOL_FRAME_SIZE, POOL_FRAMES);
+  scratchPool.begin("scratch", POOL_SCRATCH_SIZE, POOL_SCRATCH);
+}
+
+String poolsJson() {
+  // Session state is reported here, not pooled: it lives in static arrays
+  // indexed by client slot and never touches the heap, so there is no
+  // take/give and no misses, only how many of the slots are occupied
+  return "{\"sessions\":{\"pooled\":false,\"slots\":" + String(POOL_CLIENTS) + ",\"used\":" + String(topicsClientCount()) + "}" +
+         ",\"frame\":" + framePool.json() +
+         ",\"scratch\":" + scratchPool.json() + "}";
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include "metrics.h"
+#include "utilities.h"
+#include "supervisor.h"
+#include "trace_replay.h"
+#include "admission.h"
+#include "logger.h"
+
+struct RouteMetric {
+  const char* name;
+  uint32_t count;
+  uint64_t totalMicros;
+  uint32_t maxMicros;
+  uint32_t buckets[METRIC_BUCKETS];
+};
+
+static RouteMetric routeMetrics[MAX_METRIC_ROUTES];
+static uint8_t routeMetricCount = 0;
+static uint8_t routeMetricsRefused = 0;   // registrations past MAX_METRIC_ROUTES, running untimed
+static uint32_t framesDropped = 0;
+
+extern unsigned long bootMillis;
+
+int8_t metricsRegister(const char* name) {
+  if (routeMetricCount >= MAX_METRIC_ROUTES) {
+    routeMetricsRefused++;
+    LOG_W("Metrics: table full (%d), %s runs untimed", MAX_METRIC_ROUTES, name);
+    return -1;
+  }
+  routeMetrics[routeMetricCount].name = name;
+  return routeMetricCount++;
+}
+
+void metricsRecord(int8_t id, uint32_t micros) {
+  if (id < 0) return;
+
+  RouteMetric& m = routeMetrics[id];
+  uint8_t bucket = 0;
+  while (bucket < METRIC_BUCKETS - 1 && (micros >> bucket) > 1) bucket++;
+
+  m.count++;
+  m.totalMicros += micros;
+  if (micros > m.maxMicros) m.maxMicros = micros;
+  m.buckets[bucket]++;
+}
+
+WebServer::THandlerFunction timedRoute(const char* name, WebServer::THandlerFunction fn) {
+  int8_t id = metricsRegister(name);
+  RouteClass cls = routeClass(name);
+  return [id, name, cls, fn]() {
+    if (!admitRequest(cls)) return;
+    const char* prev = superEnter(name);
+    traceRequest(name);
+    uint32_t start = micros();
+    fn();
+    superLeave(prev);
+    metricsRecord(id, micros() - start);
+  };
+}
+
+void metricsFrameDropped() {
+  framesDropped++;
+}
+
+// Zeroes the counters, keeping the registered names; between steps of a load sweep
+void metricsReset() {
+  for (uint8_t i = 0; i < routeMetricCount; ++i) {
+    const char* name = routeMetrics[i].name;
+    memset(&routeMetrics[i], 0, sizeof(RouteMetric));
+    routeMetrics[i].name = name;
+  }
+  framesDropped = 0;
+}
+
+// Upper edge of the log2 bucket holding the given quantile, so p99 reads
+// as "99% of requests finished within this many microseconds".
+static uint32_t metricsQuantile(const RouteMetric& m, uint32_t perMille) {
+  uint32_t target = (uint32_t)(((uint64_t)m.count * perMille + 999) / 1000);
+  uint32_t seen = 0;
+
+  for (uint8_t b = 0; b < METRIC_BUCKETS; ++b) {
+    seen += m.buckets[b];
+    if (seen >= target) return (b + 1 < 32) ? (1UL << (b + 1)) : m.maxMicros;
+  }
+  return m.maxMicros;
+}
+
+/*
+Use :
+  curl http://mingledash.local/metrics
+  curl http://mingledash.local/metrics?reset=1     (answers, then starts the counters over)
+  One flat object per route so two firmware versions can be diffed or
+  loaded straight into a spreadsheet.
+*/
+String metricsJson() {
+  String json = "{";
+  json += "\"fw\":\"" + String(FW_VERSION) + "\",";
+  json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000) + ",";
+  json += "\"heap_free\":" + String(ESP.getFreeHeap()) + ",";
+  json += "\"heap_min_free\":" + String(ESP.getMinFreeHeap()) + ",";
+  json += "\"heap_max_alloc\":" + String(ESP.getMaxAllocHeap()) + ",";
+  json += "\"frames_dropped\":" + String(framesDropped) + ",";
+  json += "\"routes_untimed\":" + String(routeMetricsRefused) + ",";
+  json += "\"routes\":[";
+
+  for (uint8_t i = 0; i < routeMetricCount; ++i) {
+    const RouteMetric& m = routeMetrics[i];
+    if (i > 0) json += ",";
+    json += "{\"route\":\"" + String(m.name) + "\"";
+    json += ",\"count\":" + String(m.count);
+    json += ",\"avg_us\":" + String(m.count ? (uint32_t)(m.totalMicros / m.count) : 0);
+    json += ",\"max_us\":" + String(m.maxMicros);
+    json += ",\"p50_us\":" + String(m.count ? metricsQuantile(m, 500) : 0);
+    json += ",\"p99_us\":" + String(m.count ? metricsQuantile(m, 990) : 0);
+    json += "}";
+  }
+  json += "]}";
+  return json;
+}
@@ -0,0 +1,305 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <Preferences.h>
+#include "mqtt_client.h"
+#include "temp_series.h"
+#include "gpio_control.h"
+#include "wifi_setup.h"
+#include "web_server.h"
+#include "trace_replay.h"
+#include "utilities.h"
+#include "logger.h"
+
+static MqttConfig cfg;
+static WiFiClient netClient;
+static PubSubClient mqtt(netClient);
+Preferences prefs_mqtt;
+
+static uint32_t retryMs = MQTT_RETRY_MIN_MS;
+static uint32_t lastAttemptMs = 0;
+static bool attempted = false;
+static uint32_t lastBatchMs = 0;
+static bool draining = false;
+static uint32_t lastSentT = 0;      // newest sample the broker has
+static bool anySent = false;
+
+// Ring of events that arrived while the broker was out of reach
+static char events[MQTT_EVENT_QUEUE][MQTT_EVENT_SIZE];
+static uint8_t eventTopic[MQTT_EVENT_QUEUE];
+static uint8_t eventHead = 0;
+static uint8_t eventLen = 0;
+
+static struct {
+  uint32_t publishes;
+  uint32_t bytes;
+  uint32_t failures;
+  uint32_t connects;
+  uint32_t commands;
+  uint32_t eventsDropped;
+  uint32_t samplesDropped;    // fell out of the series before they could be sent
+  uint32_t rateStartMs;
+  uint32_t rateStartPublishes;
+  float rate;                 // publishes per second over the last window
+} st;
+
+static String topicFor(const char* leaf) {
+  return String(cfg.base) + "/" + leaf;
+}
+
+static const char* eventLeaf(uint8_t topic) {
+  return topic == TOPIC_OTA ? "ota" : "gpio";
+}
+
+static bool publish(const char* leaf, const char* payload, bool retain = false) {
+  String topic = topicFor(leaf);
+  size_t len = strlen(payload);
+  if (!mqtt.publish(topic.c_str(), (const uint8_t*)payload, len, retain)) {
+    st.failures++;
+    return false;
+  }
+  st.publishes++;
+  st.bytes += len;
+  return true;
+}
+
+/* ========== Commands ========== */
+
+// <base>/cmd/<output> with "on" or "off"; same effect as the HTTP routes
+static void onMessage(char* topic, uint8_t* payload, unsigned int len) {
+  const char* leaf = strrchr(topic, '/');
+  int pin = leaf ? parseOutputName(leaf + 1) : -1;
+  bool on = len == 2 && memcmp(payload, "on", 2) == 0;
+  bool off = len == 3 && memcmp(payload, "off", 3) == 0;
+  if (pin < 0 || (!on && !off)) {
+    LOG_W("MQTT: ignored command on %s", topic);
+    return;
+  }
+
+  st.commands++;
+  if (pin == LED1pin) setLed(1, on);
+  else if (pin == LED2pin) setLed(2, on);
+  else {
+    setOutput(pin, on);
+    mqttPublishEvent(TOPIC_GPIO, "{\"pin\":" + String(pin) + ",\"state\":\"" + (on ? "on" : "off") + "\"}");
+  }
+}
+
+/* ========== Publishing ========== */
+
+void mqttPublishEvent(WsTopic topic, const String& json) {
+  if (!cfg.enabled || (topic != TOPIC_GPIO && topic != TOPIC_OTA)) return;
+
+  if (eventLen == 0 && mqtt.connected() && publish(eventLeaf(topic), json.c_str())) return;
+  if (json.length() >= MQTT_EVENT_SIZE) {
+    st.eventsDropped++;
+    return;
+  }
+  if (eventLen == MQTT_EVENT_QUEUE) {     // oldest goes first
+    eventHead = (eventHead + 1) % MQTT_EVENT_QUEUE;
+    eventLen--;
+    st.eventsDropped++;
+  }
+  uint8_t slot = (eventHead + eventLen) % MQTT_EVENT_QUEUE;
+  memcpy(events[slot], json.c_str(), json.length() + 1);
+  eventTopic[slot] = topic;
+  eventLen++;
+}
+
+// Positioned at or before the oldest sample newer than lastSentT; before
+// the first publish, at the newest 64
+static TempSeries::Reader unsentReader(bool& fromStart) {
+  if (anySent) return tempSeries.readerAfter(lastSentT, fromStart);
+  uint32_t size = tempSeries.size();
+  fromStart = true;
+  return tempSeries.reader(size > 64 ? size - 64 : 0);
+}
+
+// Publishes up to MQTT_BATCH_SAMPLES after the cursor; returns how many were sent
+static uint16_t publishBatch() {
+  bool fromStart;
+  TempSeries::Reader r = unsentReader(fromStart);
+  String json;
+  json.reserve(MQTT_BATCH_SAMPLES * 18 + 16);
+  json = "{\"samples\":[";
+  uint16_t count = 0;
+  uint32_t t, first = 0, last = 0;
+  int16_t v;
+  while (count < MQTT_BATCH_SAMPLES && r.next(t, v)) {
+    if (anySent && t <= lastSentT) continue;
+    if (count == 0) first = t;
+    else json += ",";
+    json += "[" + String(t / 10.0, 1) + "," + String(v / 100.0, 2) + "]";
+    last = t;
+    count++;
+  }
+  json += "]}";
+  if (count == 0 || !publish("temp", json.c_str())) return 0;
+
+  // The oldest sample still held is newer than the gap after the cursor
+  if (anySent && fromStart && first > lastSentT + 2 * SERIES_NOMINAL_DS) {
+    st.samplesDropped += (first - lastSentT) / SERIES_NOMINAL_DS - 1;
+  }
+  lastSentT = last;
+  anySent = true;
+  return count;
+}
+
+static bool mqttConnect() {
+  String id = cfg.base;
+  id.replace('/', '-');
+  String online = topicFor("online");
+  if (!mqtt.connect(id.c_str(), online.c_str(), 0, true, "0")) return false;
+
+  mqtt.publish(online.c_str(), "1", true);
+  mqtt.subscribe(topicFor("cmd/+").c_str());
+  st.connects++;
+  LOG_I("MQTT connected to %s:%u as %S", cfg.host, (unsigned)cfg.port, id);
+  return true;
+}
+
+// Loop job. While the STA link is down nothing is sent and the cursor
+// stays put; once it is back, events go first, then the sample backlog.
+void mqttStep() {
+  if (!cfg.enabled) return;
+  uint32_t now = millis();
+
+  if (!staConnected) {
+    if (mqtt.connected()) mqtt.disconnect();
+    return;
+  }
+
+  if (!mqtt.connected()) {
+    if (attempted && now - lastAttemptMs < retryMs) return;
+    attempted = true;
+    lastAttemptMs = now;
+    if (!mqttConnect()) {
+      LOG_W("MQTT connect failed (state %d), retry in %lu ms", mqtt.state(), (unsigned long)retryMs);
+      retryMs = min<uint32_t>(retryMs * 2, MQTT_RETRY_MAX_MS);
+      return;
+    }
+    retryMs = MQTT_RETRY_MIN_MS;
+    draining = true;
+  }
+  mqtt.loop();
+
+  while (eventLen && publish(eventLeaf(eventTopic[eventHead]), events[eventHead])) {
+    eventHead = (eventHead + 1) % MQTT_EVENT_QUEUE;
+    eventLen--;
+  }
+
+  if (replayActive()) {
+    // Not this board's live readings; the cursor holds until the replay ends
+  } else if (draining || now - lastBatchMs >= MQTT_BATCH_MS) {
+    if (!draining) lastBatchMs = now;
+    draining = false;
+    for (uint8_t i = 0; i < MQTT_FLUSH_BATCHES; ++i) {
+      if (publishBatch() < MQTT_BATCH_SAMPLES) break;
+      if (i == MQTT_FLUSH_BATCHES - 1) draining = true;   // more left; carry on next pass
+    }
+  }
+
+  if (now - st.rateStartMs >= 10000) {
+    st.rate = (st.publishes - st.rateStartPublishes) * 1000.0f / (now - st.rateStartMs);
+    st.rateStartMs = now;
+    st.rateStartPublishes = st.publishes;
+  }
+}
+
+/* ========== Settings ========== */
+
+static void saveMqttConfig() {
+  prefs_mqtt.begin("mqtt", false);
+  prefs_mqtt.putBytes("cfg", &cfg, sizeof(cfg));
+  prefs_mqtt.end();
+}
+
+static void applyMqttConfig() {
+  if (cfg.base[0] == '\0') {
+    String mac = WiFi.macAddress();
+    mac.replace(":", "");
+    mac.toLowerCase();
+    snprintf(cfg.base, sizeof(cfg.base), "%s/%s", DEVICE_NAME, mac.substring(6).c_str());
+  }
+  IPAddress ip;
+  if (cfg.enabled && !ip.fromString(cfg.host)) {
+    LOG_W("MQTT: broker \"%s\" is not an IP address, disabled", cfg.host);
+    cfg.enabled = 0;
+  }
+  if (mqtt.connected()) mqtt.disconnect();
+  mqtt.setServer(ip, cfg.port);
+  attempted = false;
+  retryMs = MQTT_RETRY_MIN_MS;
+}
+
+// After initWiFi(), which the default topic base needs for the MAC
+void initMqtt() {
+  prefs_mqtt.begin("mqtt", true);
+  size_t len = prefs_mqtt.getBytes("cfg", &cfg, sizeof(cfg));
+  prefs_mqtt.end();
+
+  if (len != sizeof(cfg)) {
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.port = MQTT_DEFAULT_PORT;
+  }
+  cfg.host[sizeof(cfg.host) - 1] = '\0';
+  cfg.base[sizeof(cfg.base) - 1] = '\0';
+
+  // PubSubClient waits out its socket timeout (15 s by default) for CONNACK
+  netClient.setTimeout(MQTT_SOCKET_TIMEOUT_S);
+  mqtt.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+  mqtt.setCallback(onMessage);
+  applyMqttConfig();
+}
+
+// Empty host or base, port 0 and enable -1 each keep the current setting
+bool mqttConfigure(const String& host, uint16_t port, const String& base, int8_t enable) {
+  IPAddress ip;
+  if (host.length() >= sizeof(cfg.host) || base.length() >= sizeof(cfg.base)) return false;
+  if (host.length() && !ip.fromString(host)) return false;
+
+  if (host.length()) strcpy(cfg.host, host.c_str());
+  if (base.length()) strcpy(cfg.base, base.c_str());
+  if (port) cfg.port = port;
+  if (enable >= 0) cfg.enabled = enable;
+  if (cfg.host[0] == '\0') cfg.enabled = 0;
+  saveMqttConfig();
+  applyMqttConfig();
+  LOG_I("MQTT %s -> %s:%u", cfg.enabled ? "on" : "off", cfg.host, (unsigned)cfg.port);
+  return true;
+}
+
+String mqttJson() {
+  bool fromStart;
+  TempSeries::Reader r = unsentReader(fromStart);
+  uint32_t queued = 0;
+  uint32_t t;
+  int16_t v;
+  while (r.next(t, v)) {
+    if (!anySent || t > lastSentT) queued++;
+  }
+  // Queued samples sit in the compressed series, so they cost what it does per sample
+  float bytesPerSample = tempSeries.size() ? tempSeries.bitsUsed() / 8.0f / tempSeries.size() : 0.0f;
+
+  String json = "{\"enabled\":" + String(cfg.enabled ? "true" : "false");
+  json += ",\"host\":\"" + String(cfg.host) + "\"";
+  json += ",\"port\":" + String(cfg.port);
+  json += ",\"base\":\"" + String(cfg.base) + "\"";
+  json += ",\"connected\":" + String(mqtt.connected() ? "true" : "false");
+  json += ",\"state\":" + String(mqtt.state());
+  json += ",\"connects\":" + String(st.connects);
+  json += ",\"publishes\":" + String(st.publishes);
+  json += ",\"publish_bytes\":" + String(st.bytes);
+  json += ",\"failures\":" + String(st.failures);
+  json += ",\"publishes_per_s\":" + String(st.rate, 2);
+  json += ",\"commands\":" + String(st.commands);
+  json += ",\"queued_samples\":" + String(queued);
+  json += ",\"queued_bytes_per_sample\":" + String(bytesPerSample, 2);
+  json += ",\"dropped_samples\":" + String(st.samplesDropped);
+  json += ",\"queued_events\":" + String(eventLen);
+  json += ",\"event_slot_bytes\":" + String(MQTT_EVENT_SIZE);
+  json += ",\"dropped_events\":" + String(st.eventsDropped);
+  json += "}";
+  return json;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "driver/ledc.h"
+#include "pwm_control.h"
+#include "gpio_control.h"
+#include "logger.h"
+
+PwmChannel pwmChannels[PWM_CHANNELS];
+Preferences prefs_pwm;
+
+// The Arduino LEDC layer drives channel c from timer (c / 2) % 4, so
+// neighbours 2n and 2n+1 share a frequency: ledcSetup() on one silently
+// retunes the other. PWM channel ch therefore uses LEDC channel 2 * ch,
+// which gives each of the four its own timer.
+static uint8_t ledcChannel(uint8_t ch) {
+  return ch * 2;
+}
+
+// ...and maps LEDC channel c onto speed mode c / 8 and driver channel
+// c % 8; the fade engine is addressed the same way.
+static ledc_mode_t pwmMode(uint8_t ch) {
+  return (ledc_mode_t)(ledcChannel(ch) / 8);
+}
+
+static ledc_channel_t pwmDriverChannel(uint8_t ch) {
+  return (ledc_channel_t)(ledcChannel(ch) % 8);
+}
+
+// LED1/LED2 stay with gpio_control
+static bool pwmPinUsable(uint8_t pin) {
+  return isOutputPin(pin) && pin != LED1pin && pin != LED2pin;
+}
+
+void savePwmStates() {
+  prefs_pwm.begin("pwm", false);
+  prefs_pwm.putBytes("ch", pwmChannels, sizeof(pwmChannels));
+  prefs_pwm.end();
+}
+
+static void loadPwmStates() {
+  prefs_pwm.begin("pwm", true);
+  size_t len = prefs_pwm.getBytes("ch", pwmChannels, sizeof(pwmChannels));
+  prefs_pwm.end();
+
+  for (uint8_t ch = 0; ch < PWM_CHANNELS; ++ch) {
+    PwmChannel& c = pwmChannels[ch];
+    bool valid = len == sizeof(pwmChannels);
+    if (valid && c.pin != 0xFF && !pwmPinUsable(c.pin)) {
+      // Stored before the check existed; attaching it at every boot would
+      // hang on the flash pins, so the channel is freed instead
+      LOG_W("PWM ch%u: stored pin %u refused", (unsigned)ch, (unsigned)c.pin);
+      valid = false;
+    }
+    if (!valid) {
+      c.pin = 0xFF;
+      c.duty = 0;
+      c.freq = PWM_DEFAULT_FREQ;
+    }
+  }
+}
+
+// Restores every assigned channel straight to its saved duty, no fade
+void initPWM() {
+  loadPwmStates();
+  ledc_fade_func_install(0);
+
+  for (uint8_t ch = 0; ch < PWM_CHANNELS; ++ch) {
+    PwmChannel& c = pwmChannels[ch];
+    if (c.pin == 0xFF) continue;
+
+    ledcSetup(ledcChannel(ch), c.freq, PWM_RESOLUTION_BITS);
+    ledcWrite(ledcChannel(ch), c.duty);
+    ledcAttachPin(c.pin, ledcChannel(ch));
+  }
+}
+
+bool pwmConfigure(uint8_t ch, uint8_t pin, uint32_t freq) {
+  if (ch >= PWM_CHANNELS || !pwmPinUsable(pin)) return false;
+  for (uint8_t other = 0; other < PWM_CHANNELS; ++other) {
+    if (other != ch && pwmChannels[other].pin == pin) return false;
+  }
+
+  // Checked last: it retunes the channel's timer straight away
+  if (freq == 0 || ledcSetup(ledcChannel(ch), freq, PWM_RESOLUTION_BITS) == 0) return false;
+
+  PwmChannel& c = pwmChannels[ch];
+  if (c.pin != 0xFF && c.pin != pin) ledcDetachPin(c.pin);
+
+  c.pin = pin;
+  c.freq = freq;
+  ledcWrite(ledcChannel(ch), c.duty);
+  ledcAttachPin(pin, ledcChannel(ch));
+  savePwmStates();
+  return true;
+}
+
+// fadeMs > 0 hands the ramp to the LEDC fade engine: the hardware steps
+// the duty on its own and the call returns immediately.
+bool pwmSetDuty(uint8_t ch, uint16_t duty, uint32_t fadeMs) {
+  if (ch >= PWM_CHANNELS || pwmChannels[ch].pin == 0xFF || duty > PWM_MAX_DUTY) return false;
+
+  if (fadeMs > 0) {
+    if (ledc_set_fade_with_time(pwmMode(ch), pwmDriverChannel(ch), duty, fadeMs) != ESP_OK) return false;
+    ledc_fade_start(pwmMode(ch), pwmDriverChannel(ch), LEDC_FADE_NO_WAIT);
+  } else {
+    ledcWrite(ledcChannel(ch), duty);
+  }
+
+  pwmChannels[ch].duty = duty;
+  savePwmStates();
+  LOG_D("PWM ch%u -> %u over %lu ms", (unsigned)ch, (unsigned)duty, (unsigned long)fadeMs);
+  return true;
+}
+
+String pwmJson() {
+  String json = "{\"resolution\":" + String(PWM_RESOLUTION_BITS) + ",\"channels\":[";
+
+  for (uint8_t ch = 0; ch < PWM_CHANNELS; ++ch) {
+    const PwmChannel& c = pwmChannels[ch];
+    if (ch > 0) json += ",";
+    json += "{\"ch\":" + String(ch);
+    if (c.pin == 0xFF) {
+      json += ",\"pin\":null";
+    } else {
+      json += ",\"pin\":" + String(c.pin);
+      json += ",\"freq\":" + String(c.freq);
+      json += ",\"duty\":" + String(c.duty);
+      json += ",\"current\":" + String(ledc_get_duty(pwmMode(ch), pwmDriverChannel(ch)));
+    }
+    json += "}";
+  }
+  json += "]}";
+  return json;
+}
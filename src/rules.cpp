@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "rules.h"
+#include "gpio_control.h"
+#include "web_server.h"
+#include "logger.h"
+
+static RuleCode ruleCode[MAX_RULES];
+static uint8_t ruleCount = 0;
+
+// Runtime state, rebuilt from scratch at boot
+static unsigned long ruleSince[MAX_RULES];
+static uint8_t ruleFlags[MAX_RULES];
+#define RULE_PENDING 0x01
+#define RULE_ACTIVE  0x02
+
+static uint32_t ruleEvalMicros = 0;
+static uint32_t ruleEvalMaxMicros = 0;
+
+Preferences prefs_rules;
+
+static void saveRules() {
+  prefs_rules.begin("rules", false);
+  prefs_rules.putBytes("code", ruleCode, ruleCount * sizeof(RuleCode));
+  prefs_rules.end();
+}
+
+void initRules() {
+  prefs_rules.begin("rules", true);
+  size_t len = prefs_rules.getBytesLength("code");
+  if (len > sizeof(ruleCode)) len = sizeof(ruleCode);
+  ruleCount = prefs_rules.getBytes("code", ruleCode, len) / sizeof(RuleCode);
+  prefs_rules.end();
+
+  memset(ruleFlags, 0, sizeof(ruleFlags));
+  LOG_I("Loaded %u rules", (unsigned)ruleCount);
+}
+
+static void announceOutput(uint8_t pin, bool on) {
+  if (pin == LED1pin || pin == LED2pin) {
+    broadcastEvent("{\"" + outputName(pin) + "\":" + String(on ? "true" : "false") + "}", TOPIC_GPIO);
+  } else {
+    broadcastEvent("{\"pin\":" + String(pin) + ",\"state\":\"" + String(on ? "on" : "off") + "\"}", TOPIC_GPIO);
+  }
+}
+
+// Called from the sampling path with every new reading. The outputs are
+// switched inside the timed loop; persisting and broadcasting the change
+// happen afterwards so they don't count against the reaction time.
+void evaluateRules(float tempC, unsigned long nowMillis) {
+  int16_t t = (int16_t)lroundf(tempC * 100.0f);
+  uint8_t changedPin[MAX_RULES];
+  uint8_t changedLevel[MAX_RULES];
+  uint8_t changes = 0;
+  uint32_t start = micros();
+
+  for (uint8_t i = 0; i < ruleCount; ++i) {
+    const RuleCode& r = ruleCode[i];
+    int16_t band = (int16_t)r.hyst * 10;
+    bool hit = (r.op == RULE_OP_GT) ? (t > r.threshold) : (t < r.threshold);
+    bool released = (r.op == RULE_OP_GT) ? (t <= r.threshold - band) : (t >= r.threshold + band);
+    bool fire = false;
+    bool level = false;
+
+    if (ruleFlags[i] & RULE_ACTIVE) {
+      if (released) {
+        ruleFlags[i] = 0;
+        fire = true;
+        level = !r.action;
+      }
+    } else if (hit) {
+      if (!(ruleFlags[i] & RULE_PENDING)) {
+        ruleFlags[i] |= RULE_PENDING;
+        ruleSince[i] = nowMillis;
+      }
+      if (nowMillis - ruleSince[i] >= (unsigned long)r.holdSec * 1000UL) {
+        ruleFlags[i] = RULE_ACTIVE;
+        fire = true;
+        level = r.action;
+      }
+    } else {
+      ruleFlags[i] &= ~RULE_PENDING;
+    }
+
+    if (fire) {
+      setOutput(r.pin, level);
+      changedPin[changes] = r.pin;
+      changedLevel[changes] = level;
+      changes++;
+    }
+  }
+
+  ruleEvalMicros = micros() - start;
+  if (ruleEvalMicros > ruleEvalMaxMicros) ruleEvalMaxMicros = ruleEvalMicros;
+
+  if (changes == 0) return;
+
+  saveStates();
+  for (uint8_t i = 0; i < changes; ++i) {
+    LOG_I("Rule set %S %s", outputName(changedPin[i]), changedLevel[i] ? "on" : "off");
+    announceOutput(changedPin[i], changedLevel[i]);
+  }
+}
+
+// Compiles "temp>55 for 10 hyst 2 then led2 on" into one RuleCode.
+static bool compileRule(const String& text, RuleCode& out, String& error) {
+  char buf[96];
+  char* save;
+  const char* tok;
+
+  strlcpy(buf, text.c_str(), sizeof(buf));
+  memset(&out, 0, sizeof(out));
+
+  tok = strtok_r(buf, " ", &save);
+  if (!tok || strncmp(tok, "temp", 4) != 0 || (tok[4] != '>' && tok[4] != '<')) {
+    error = "expected temp>N or temp<N";
+    return false;
+  }
+  char* end;
+  float threshold = strtof(tok + 5, &end);
+  if (end == tok + 5 || *end != 0 || threshold < -300 || threshold > 300) {
+    error = "bad threshold";
+    return false;
+  }
+  out.op = tok[4] == '>' ? RULE_OP_GT : RULE_OP_LT;
+  out.threshold = (int16_t)lroundf(threshold * 100.0f);
+
+  while ((tok = strtok_r(NULL, " ", &save)) != NULL) {
+    if (strcmp(tok, "for") == 0) {
+      tok = strtok_r(NULL, " ", &save);
+      long hold = tok ? strtol(tok, &end, 10) : -1;
+      if (!tok || *end != 0 || hold < 0 || hold > 65535) {
+        error = "bad hold time";
+        return false;
+      }
+      out.holdSec = (uint16_t)hold;
+    } else if (strcmp(tok, "hyst") == 0) {
+      tok = strtok_r(NULL, " ", &save);
+      float hyst = tok ? strtof(tok, &end) : -1;
+      if (!tok || *end != 0 || hyst < 0 || hyst > 25.5f) {
+        error = "hysteresis must be 0..25.5";
+        return false;
+      }
+      out.hyst = (uint8_t)lroundf(hyst * 10.0f);
+    } else if (strcmp(tok, "then") == 0) {
+      const char* target = strtok_r(NULL, " ", &save);
+      const char* level = strtok_r(NULL, " ", &save);
+
+      if (!target || !level) {
+        error = "expected then <output> on|off";
+        return false;
+      }
+      int pin = parseOutputName(target);
+      if (pin < 0) {
+        error = "unknown output";
+        return false;
+      }
+      out.pin = (uint8_t)pin;
+
+      if (strcmp(level, "on") == 0) {
+        out.action = HIGH;
+      } else if (strcmp(level, "off") == 0) {
+        out.action = LOW;
+      } else {
+        error = "expected on or off";
+        return false;
+      }
+      return true;
+    } else {
+      error = "unexpected token";
+      return false;
+    }
+  }
+
+  error = "missing then clause";
+  return false;
+}
+
+bool addRule(const String& text, String& error) {
+  RuleCode code;
+
+  if (ruleCount >= MAX_RULES) {
+    error = "rule table full";
+    return false;
+  }
+  if (!compileRule(text, code, error)) return false;
+
+  ruleCode[ruleCount] = code;
+  ruleFlags[ruleCount] = 0;
+  ruleCount++;
+  saveRules();
+  return true;
+}
+
+bool deleteRule(uint8_t id) {
+  if (id >= ruleCount) return false;
+
+  memmove(&ruleCode[id], &ruleCode[id + 1], (ruleCount - id - 1) * sizeof(RuleCode));
+  memmove(&ruleFlags[id], &ruleFlags[id + 1], ruleCount - id - 1);
+  memmove(&ruleSince[id], &ruleSince[id + 1], (ruleCount - id - 1) * sizeof(ruleSince[0]));
+  ruleCount--;
+  saveRules();
+  return true;
+}
+
+void clearRules() {
+  ruleCount = 0;
+  saveRules();
+}
+
+String rulesJson() {
+  String json = "{\"eval_us\":" + String(ruleEvalMicros) + ",\"eval_max_us\":" + String(ruleEvalMaxMicros) + ",\"rules\":[";
+
+  for (uint8_t i = 0; i < ruleCount; ++i) {
+    const RuleCode& r = ruleCode[i];
+    if (i > 0) json += ",";
+    json += "{\"id\":" + String(i) + ",\"rule\":\"temp";
+    json += (r.op == RULE_OP_GT ? ">" : "<") + String(r.threshold / 100.0f, 2);
+    json += " for " + String(r.holdSec) + " hyst " + String(r.hyst / 10.0f, 1);
+    json += " then " + outputName(r.pin) + (r.action ? " on" : " off") + "\"";
+    json += ",\"active\":" + String((ruleFlags[i] & RULE_ACTIVE) ? "true" : "false") + "}";
+  }
+  json += "]}";
+  return json;
+}
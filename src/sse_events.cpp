@@ -0,0 +1,94 @@
+#include <Arduino.h>
+#include <WebServer.h>
+#include <lwip/sockets.h>
+#include "sse_events.h"
+#include "web_server.h"
+#include "logger.h"
+#include "metrics.h"
+
+
+// A stream is just the accepted socket, taken off WebServer with
+// detachClient() so the server moves on to the next request at once.
+static WiFiClient sseClients[MAX_SSE_CLIENTS];
+static bool sseActive[MAX_SSE_CLIENTS];
+
+static const char sseHeaders[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/event-stream\r\n"
+  "Cache-Control: no-cache\r\n"
+  "Connection: keep-alive\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "\r\n"
+  "retry: 3000\n\n";
+
+// Never let a slow reader stall loop(): write what the socket buffer takes
+// right now and drop the stream on a short write. EventSource reconnects
+// on its own and the next tick carries the full state again.
+static bool sseWrite(WiFiClient& client, const char* data, size_t len) {
+  int fd = client.fd();
+  if (fd < 0) return false;
+
+  int sent = send(fd, data, len, MSG_DONTWAIT);
+  return sent == (int)len;
+}
+
+static void sseDrop(uint8_t i) {
+  sseClients[i].stop();
+  sseClients[i] = WiFiClient();
+  sseActive[i] = false;
+}
+
+void handleEventsConnect() {
+  int slot = -1;
+
+  for (uint8_t i = 0; i < MAX_SSE_CLIENTS; ++i) {
+    if (sseActive[i] && !sseClients[i].connected()) sseDrop(i);
+    if (!sseActive[i] && slot < 0) slot = i;
+  }
+
+  if (slot < 0) {
+    server.sendHeader("Retry-After", "5");
+    server.send(503, "text/plain", "Too many event streams");
+    return;
+  }
+
+  WiFiClient client = server.detachClient();
+  String hello = String(sseHeaders) + "data: " + statusJson() + "\n\n";
+  if (!sseWrite(client, hello.c_str(), hello.length())) {
+    client.stop();
+    return;
+  }
+
+  sseClients[slot] = client;
+  sseActive[slot] = true;
+  LOG_I("SSE client %d connected from %I", slot, client.remoteIP());
+}
+
+void sseBroadcast(const String& json) {
+  String frame;
+
+  for (uint8_t i = 0; i < MAX_SSE_CLIENTS; ++i) {
+    if (!sseActive[i]) continue;
+
+    if (frame.length() == 0) {
+      frame.reserve(json.length() + 8);
+      frame = "data: ";
+      frame += json;
+      frame += "\n\n";
+    }
+
+    if (!sseClients[i].connected() || !sseWrite(sseClients[i], frame.c_str(), frame.length())) {
+      LOG_I("SSE client %d dropped", i);
+      metricsFrameDropped();
+      sseDrop(i);
+    }
+  }
+}
+
+uint8_t sseClientCount() {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < MAX_SSE_CLIENTS; ++i) {
+    if (sseActive[i]) count++;
+  }
+  return count;
+}
@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "rom/crc.h"
+#include "supervisor.h"
+#include "logger.h"
+
+#define STALL_MAGIC 0x5354414C   // "STAL"
+
+static const char* const heartbeatNames[HB_COUNT] = { "loop", "ws", "sample" };
+static const uint32_t heartbeatLimitMs[HB_COUNT] = { STALL_REPORT_MS, STALL_REPORT_MS, STALL_REPORT_MS + 2000 };
+
+// Tasks worth a stack watermark; the list is by name because the trace
+// facility (uxTaskGetSystemState) is off in this sdkconfig.
+static const char* const watchedTasks[STALL_TASKS] = {
+  "loopTask", "logDrain", "supervisor", "esp_timer", "tiT",
+  "wifi", "sys_evt", "ipc0", "IDLE0", "IDLE1"
+};
+
+RTC_NOINIT_ATTR static StallReport retained;
+static StallReport previous;          // copy of what the last boot left behind
+static bool havePrevious = false;
+
+static volatile uint32_t lastBeat[HB_COUNT];
+static volatile const char* activity = "setup";
+static volatile uint32_t activitySince = 0;
+static volatile uint8_t holdDepth = 0;
+static volatile const char* holdWhy = nullptr;
+static volatile uint32_t holdSince = 0;
+
+void superBeat(Heartbeat hb) {
+  lastBeat[hb] = millis();
+}
+
+// Tags what the loop is doing; returns the outer tag for superLeave()
+const char* superEnter(const char* tag) {
+  const char* outer = (const char*)activity;
+  activity = tag;
+  activitySince = millis();
+  return outer;
+}
+
+void superLeave(const char* outer) {
+  activity = outer;
+  activitySince = millis();
+}
+
+/*
+Use :
+  superHold("ota");      // before work that legitimately keeps the loop
+  ...                    // inside one handler for longer than STALL_REBOOT_MS
+  superRelease();
+While held, stale heartbeats are neither reported nor rebooted on, for at
+most STALL_HOLD_MAX_MS so a transfer that hangs still ends in a restart.
+*/
+void superHold(const char* why) {
+  if (holdDepth++ == 0) {
+    holdWhy = why;
+    holdSince = millis();
+  }
+}
+
+// Heartbeats restart from here: the held time is excused, not carried over
+void superRelease() {
+  if (holdDepth == 0) return;
+  if (--holdDepth > 0) return;
+  holdWhy = nullptr;
+  uint32_t now = millis();
+  for (uint8_t hb = 0; hb < HB_COUNT; ++hb) lastBeat[hb] = now;
+}
+
+static uint32_t reportCrc(const StallReport& r) {
+  return crc32_le(0, (const uint8_t*)&r.uptimeMs, sizeof(StallReport) - offsetof(StallReport, uptimeMs));
+}
+
+static void captureReport(uint8_t hb, uint32_t now) {
+  StallReport& r = retained;
+  memset(&r, 0, sizeof(r));
+  r.uptimeMs = now;
+  r.stalledMs = now - lastBeat[hb];
+  strlcpy(r.heartbeat, heartbeatNames[hb], sizeof(r.heartbeat));
+  strlcpy(r.activity, (const char*)activity, sizeof(r.activity));
+  r.activityMs = now - activitySince;
+
+  r.heapFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  r.heapMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  r.heapLargest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  r.fragPct = r.heapFree ? 100 - (uint8_t)((uint64_t)r.heapLargest * 100 / r.heapFree) : 0;
+
+  for (uint8_t i = 0; i < STALL_TASKS; ++i) {
+    TaskHandle_t t = xTaskGetHandle(watchedTasks[i]);
+    if (!t) continue;
+    StallTask& st = r.tasks[r.taskCount++];
+    strlcpy(st.name, watchedTasks[i], sizeof(st.name));
+    st.stackFree = uxTaskGetStackHighWaterMark(t);
+  }
+
+  r.crc = reportCrc(r);
+  r.magic = STALL_MAGIC;
+}
+
+static void supervisorTask(void* arg) {
+  bool reported = false;
+
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(500));
+    uint32_t now = millis();
+
+    int8_t stalled = -1;
+    uint32_t worst = 0;
+    for (uint8_t hb = 0; hb < HB_COUNT; ++hb) {
+      uint32_t age = now - lastBeat[hb];
+      if (age >= heartbeatLimitMs[hb] && age > worst) {
+        worst = age;
+        stalled = hb;
+      }
+    }
+
+    if (stalled < 0) {
+      reported = false;
+      continue;
+    }
+    if (holdDepth > 0 && now - holdSince < STALL_HOLD_MAX_MS) continue;
+
+    if (!reported) {
+      reported = true;
+      captureReport(stalled, now);
+      LOG_W("Stall: %s heartbeat %lu ms old, in %s", heartbeatNames[stalled], (unsigned long)worst, retained.activity);
+    }
+
+    if (worst >= STALL_REBOOT_MS) {
+      retained.rebooted = 1;
+      retained.stalledMs = worst;
+      retained.crc = reportCrc(retained);
+      delay(200);   // let the log line out
+      ESP.restart();
+    }
+  }
+}
+
+// Picks up a report left by the previous boot, then starts watching.
+// Runs on core 0 so a loop stuck on core 1 can't starve it.
+void initSupervisor() {
+  havePrevious = retained.magic == STALL_MAGIC && retained.crc == reportCrc(retained);
+  if (havePrevious) {
+    previous = retained;
+    LOG_W("Previous boot stalled in %s (%s heartbeat)", previous.activity, previous.heartbeat);
+  }
+  retained.magic = 0;
+
+  uint32_t now = millis();
+  for (uint8_t hb = 0; hb < HB_COUNT; ++hb) lastBeat[hb] = now;
+  xTaskCreatePinnedToCore(supervisorTask, "supervisor", 3072, NULL, 2, NULL, 0);
+}
+
+static String reportJson(const StallReport& r) {
+  String json = "{";
+  json += "\"heartbeat\":\"" + String(r.heartbeat) + "\",";
+  json += "\"activity\":\"" + String(r.activity) + "\",";
+  json += "\"activity_ms\":" + String(r.activityMs) + ",";
+  json += "\"stalled_ms\":" + String(r.stalledMs) + ",";
+  json += "\"uptime_ms\":" + String(r.uptimeMs) + ",";
+  json += "\"rebooted\":" + String(r.rebooted ? "true" : "false") + ",";
+  json += "\"heap_free\":" + String(r.heapFree) + ",";
+  json += "\"heap_min_free\":" + String(r.heapMinFree) + ",";
+  json += "\"heap_largest\":" + String(r.heapLargest) + ",";
+  json += "\"frag_pct\":" + String(r.fragPct) + ",";
+  json += "\"stack_free\":{";
+  for (uint8_t i = 0; i < r.taskCount && i < STALL_TASKS; ++i) {
+    if (i > 0) json += ",";
+    json += "\"" + String(r.tasks[i].name) + "\":" + String(r.tasks[i].stackFree);
+  }
+  json += "}}";
+  return json;
+}
+
+String stallReportJson() {
+  uint32_t now = millis();
+  String json = "{\"previous\":" + (havePrevious ? reportJson(previous) : String("null"));
+  if (retained.magic == STALL_MAGIC) json += ",\"current\":" + reportJson(retained);
+
+  json += ",\"heartbeat_age_ms\":{";
+  for (uint8_t hb = 0; hb < HB_COUNT; ++hb) {
+    if (hb > 0) json += ",";
+    json += "\"" + String(heartbeatNames[hb]) + "\":" + String(now - lastBeat[hb]);
+  }
+  json += "},\"activity\":\"" + String((const char*)activity) + "\"";
+  if (holdDepth > 0) {
+    json += ",\"hold\":\"" + String((const char*)holdWhy) + "\",\"hold_ms\":" + String(now - holdSince);
+  } else {
+    json += ",\"hold\":null";
+  }
+  json += "}";
+  return json;
+}
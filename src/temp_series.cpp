@@ -0,0 +1,288 @@
+#include <Arduino.h>
+#include "temp_series.h"
+#include "fs_spiffs.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include <new>
+
+static_assert(sizeof(SeriesBlock) == SERIES_BLOCK_BYTES, "SeriesBlock must pack to one block");
+
+#define DATA_BITS (sizeof(((SeriesBlock*)0)->data) * 8)
+
+// Kept in RTC slow memory so a planned restart can hand the history to
+// the next boot, including into a new image after OTA or /switch_partition:
+// .rtc_noinit sits behind only the small RTC data sections, so unlike
+// .noinit DRAM it does not move when .data or .bss change size. It is
+// 4.6 of the 8 KB there; warm_restart decides whether the contents are
+// still trustworthy.
+RTC_NOINIT_ATTR static uint32_t seriesStore[(sizeof(TempSeries) + 3) / 4];
+TempSeries& tempSeries = *reinterpret_cast<TempSeries*>(seriesStore);
+
+static uint32_t clockBaseDs = 0;
+
+static uint32_t zigzag(int32_t n) {
+  return ((uint32_t)n << 1) ^ (uint32_t)(n >> 31);
+}
+
+static int32_t unzigzag(uint32_t n) {
+  return (int32_t)(n >> 1) ^ -(int32_t)(n & 1);
+}
+
+static void writeBits(SeriesBlock& b, uint32_t value, uint8_t n) {
+  while (n--) {
+    uint16_t pos = b.bits++;
+    if (value & (1UL << n)) b.data[pos >> 3] |= 0x80 >> (pos & 7);
+  }
+}
+
+static uint32_t readBits(const SeriesBlock& b, uint16_t& pos, uint8_t n) {
+  uint32_t value = 0;
+  while (n--) {
+    value = (value << 1) | ((b.data[pos >> 3] >> (7 - (pos & 7))) & 1);
+    pos++;
+  }
+  return value;
+}
+
+static uint8_t timeBits(uint32_t zz) {
+  return zz == 0 ? 1 : zz < 128 ? 9 : zz < 512 ? 12 : zz < 4096 ? 16 : 36;
+}
+
+static uint8_t valueBits(uint32_t zz) {
+  return zz == 0 ? 1 : zz < 256 ? 10 : zz < 4096 ? 15 : 19;
+}
+
+static void startBlock(SeriesBlock& b, uint32_t tDs, int16_t vCenti) {
+  memset(&b, 0, sizeof(b));
+  b.t0 = tDs;
+  b.v0 = vCenti;
+  b.count = 1;
+}
+
+// keep = true continues the retained series, with its clock picking up
+// just after the last stored sample.
+void initTempSeries(bool keep) {
+  if (keep) {
+    clockBaseDs = tempSeries.lastTime() + SERIES_NOMINAL_DS;
+  } else {
+    new (seriesStore) TempSeries();
+    clockBaseDs = 0;
+  }
+}
+
+uint32_t seriesNowDs() {
+  return clockBaseDs + millis() / 100;
+}
+
+void TempSeries::clear() {
+  head = 0;
+  used = 0;
+  samples = 0;
+  blocks[0].count = 0;
+}
+
+void TempSeries::append(uint32_t tDs, int16_t vCenti) {
+  int32_t delta = (int32_t)(tDs - lastT);
+  uint32_t dod = zigzag(delta - lastDelta);
+  uint32_t dv = zigzag((int32_t)vCenti - lastV);
+
+  if (used == 0) {
+    used = 1;
+    startBlock(blocks[head], tDs, vCenti);
+    delta = SERIES_NOMINAL_DS;
+  } else if ((size_t)(blocks[head].bits + timeBits(dod) + valueBits(dv)) > DATA_BITS) {
+    // Seal the open block; once the ring is full the oldest block is recycled
+    head = (head + 1) % SERIES_BLOCKS;
+    if (used == SERIES_BLOCKS) samples -= blocks[head].count;
+    else used++;
+    startBlock(blocks[head], tDs, vCenti);
+    delta = SERIES_NOMINAL_DS;
+  } else {
+    SeriesBlock& b = blocks[head];
+    if (dod == 0)            writeBits(b, 0x0, 1);
+    else if (dod < 128)      { writeBits(b, 0x2, 2);  writeBits(b, dod, 7); }
+    else if (dod < 512)      { writeBits(b, 0x6, 3);  writeBits(b, dod, 9); }
+    else if (dod < 4096)     { writeBits(b, 0xE, 4);  writeBits(b, dod, 12); }
+    else                     { writeBits(b, 0xF, 4);  writeBits(b, dod, 32); }
+
+    if (dv == 0)             writeBits(b, 0x0, 1);
+    else if (dv < 256)       { writeBits(b, 0x2, 2);  writeBits(b, dv, 8); }
+    else if (dv < 4096)      { writeBits(b, 0x6, 3);  writeBits(b, dv, 12); }
+    else                     { writeBits(b, 0x7, 3);  writeBits(b, (uint16_t)vCenti, 16); }
+    b.count++;
+  }
+
+  samples++;
+  lastT = tDs;
+  lastDelta = delta;
+  lastV = vCenti;
+}
+
+uint32_t TempSeries::bitsUsed() const {
+  uint32_t bits = 0;
+  for (uint8_t i = 0; i < used; ++i) {
+    bits += (SERIES_BLOCK_BYTES - sizeof(((SeriesBlock*)0)->data)) * 8 + blocks[i].bits;
+  }
+  return bits;
+}
+
+// Oldest sample first; skip is decoded and dropped
+TempSeries::Reader TempSeries::reader(uint32_t skip) const {
+  Reader r;
+  r.series = this;
+  r.block = (head + SERIES_BLOCKS - (used ? used - 1 : 0)) % SERIES_BLOCKS;
+  r.blocksLeft = used;
+  r.index = 0;
+
+  // Whole blocks can be skipped from their headers alone
+  while (r.blocksLeft > 1 && skip >= blocks[r.block].count) {
+    skip -= blocks[r.block].count;
+    r.block = (r.block + 1) % SERIES_BLOCKS;
+    r.blocksLeft--;
+  }
+
+  uint32_t t;
+  int16_t v;
+  while (skip-- && r.next(t, v)) {}
+  return r;
+}
+
+// Positioned at or before the oldest sample newer than tDs. Looks back in
+// doubling steps, so catching up costs about as much as the backlog;
+// fromStart is set when the walk ran into the oldest sample still held.
+TempSeries::Reader TempSeries::readerAfter(uint32_t tDs, bool& fromStart) const {
+  uint32_t back = 64;
+  while (back < samples) {
+    Reader probe = reader(samples - back);
+    uint32_t t;
+    int16_t v;
+    if (probe.next(t, v) && t <= tDs) break;
+    back *= 2;
+  }
+  fromStart = back >= samples;
+  return reader(back < samples ? samples - back : 0);
+}
+
+bool TempSeries::Reader::next(uint32_t& tDs, int16_t& vCenti) {
+  while (blocksLeft && index >= series->blocks[block].count) {
+    block = (block + 1) % SERIES_BLOCKS;
+    blocksLeft--;
+    index = 0;
+  }
+  if (!blocksLeft) return false;
+
+  const SeriesBlock& b = series->blocks[block];
+  if (index == 0) {
+    bitPos = 0;
+    t = b.t0;
+    v = b.v0;
+    delta = SERIES_NOMINAL_DS;
+  } else {
+    uint32_t dod = 0;
+    if (readBits(b, bitPos, 1)) {
+      if (!readBits(b, bitPos, 1))      dod = readBits(b, bitPos, 7);
+      else if (!readBits(b, bitPos, 1)) dod = readBits(b, bitPos, 9);
+      else if (!readBits(b, bitPos, 1)) dod = readBits(b, bitPos, 12);
+      else                              dod = readBits(b, bitPos, 32);
+    }
+    delta += unzigzag(dod);
+    t += delta;
+
+    if (readBits(b, bitPos, 1)) {
+      if (!readBits(b, bitPos, 1))      v += unzigzag(readBits(b, bitPos, 8));
+      else if (!readBits(b, bitPos, 1)) v += unzigzag(readBits(b, bitPos, 12));
+      else                              v = (int16_t)readBits(b, bitPos, 16);
+    }
+  }
+
+  index++;
+  tDs = t;
+  vCenti = v;
+  return true;
+}
+
+static void appendStats(String& json, const TempSeries& s) {
+  uint32_t bits = s.bitsUsed();
+  int64_t start = esp_timer_get_time();
+  TempSeries::Reader r = s.reader();
+  uint32_t t;
+  int16_t v;
+  uint32_t decoded = 0;
+  while (r.next(t, v)) decoded++;
+  uint32_t decodeUs = esp_timer_get_time() - start;
+
+  json += "\"samples\":" + String(s.size()) + ",";
+  json += "\"blocks\":" + String(s.blocksUsed()) + ",";
+  json += "\"bytes\":" + String(s.blocksUsed() * SERIES_BLOCK_BYTES) + ",";
+  json += "\"bits_per_sample\":" + String(s.size() ? (float)bits / s.size() : 0.0f, 2) + ",";
+  // Against the old float + unsigned long pair per sample
+  json += "\"ratio\":" + String(bits ? (float)s.size() * 64 / bits : 0.0f, 1) + ",";
+  json += "\"decode_us\":" + String(decodeUs) + ",";
+  json += "\"decode_samples_per_ms\":" + String(decodeUs ? decoded * 1000UL / decodeUs : 0);
+}
+
+// One "seconds,temp" line of a bench trace; headers and junk are skipped
+static void benchLine(TempSeries& series, const char* line) {
+  char* end;
+  float seconds = strtof(line, &end);
+  if (end == line || *end != ',') return;
+  float temp = strtof(end + 1, nullptr);
+  series.append(lroundf(seconds * 10), lroundf(temp * 100));
+}
+
+/*
+Use :
+  seriesStatsJson();                    live series
+  seriesStatsJson("/tempData.csv");     also replays a recorded "seconds,temp" trace
+*/
+String seriesStatsJson(const char* benchCsv) {
+  String json = "{\"capacity_bytes\":" + String(sizeof(SeriesBlock) * SERIES_BLOCKS) + ",";
+  appendStats(json, tempSeries);
+
+  if (benchCsv) {
+    File file = fsMounted() ? APP_FS.open(benchCsv) : File();
+    TempSeries* scratch = file ? new (std::nothrow) TempSeries() : nullptr;
+    if (scratch) {
+      // Block reads, split into lines here; readBytesUntil() would go
+      // through the FS one byte per call. Over-long lines are cut short.
+      char block[FS_CHUNK_SIZE];
+      char line[48];
+      size_t lineLen = 0;
+      int n;
+      while ((n = file.read((uint8_t*)block, sizeof(block))) > 0) {
+        for (int i = 0; i < n; ++i) {
+          if (block[i] != '\n') {
+            if (lineLen < sizeof(line) - 1) line[lineLen++] = block[i];
+            continue;
+          }
+          line[lineLen] = '\0';
+          lineLen = 0;
+          benchLine(*scratch, line);
+        }
+      }
+      line[lineLen] = '\0';
+      benchLine(*scratch, line);    // last line, if it has no newline
+      json += ",\"bench\":{";
+      appendStats(json, *scratch);
+      json += "}";
+      delete scratch;
+    }
+    if (file) file.close();
+  }
+
+  json += "}";
+  return json;
+}
+
+// As many {"time":s,"temp":c} items from r as fit in out, comma separated,
+// no brackets. Stops with room to spare instead of splitting an item, so
+// nothing is lost between calls; 0 once r is exhausted.
+size_t seriesJsonChunk(TempSeries::Reader& r, char* out, size_t cap) {
+  size_t len = 0;
+  uint32_t t;
+  int16_t v;
+  while (len + SERIES_JSON_ITEM_MAX < cap && r.next(t, v)) {
+    len += snprintf(out + len, cap - len, "%s{\"time\":%.1f,\"temp\":%.2f}", len ? "," : "", t / 10.0, v / 100.0);
+  }
+  return len;
+}
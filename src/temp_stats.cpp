@@ -0,0 +1,147 @@
+#include <Arduino.h>
+#include "temp_stats.h"
+
+#define QCAP (STATS_SLOTS + 1)
+
+static const struct {
+  const char* name;
+  uint32_t slotMs;
+} windowDefs[STATS_WINDOWS] = {
+  { "1m",  1000UL },
+  { "10m", 10000UL },
+  { "1h",  60000UL },
+};
+
+TempStats liveStats;
+
+TempStats::TempStats() {
+  statsReset(*this);
+}
+
+static void welfordAdd(StatsAgg& a, double x) {
+  a.n++;
+  double d = x - a.mean;
+  a.mean += d / a.n;
+  a.m2 += d * (x - a.mean);
+}
+
+// Inverse of Chan's parallel merge: take a sub-aggregate back out of a total
+static void chanRemove(StatsAgg& a, uint32_t n, double mean, double m2) {
+  if (n == 0) return;
+  if (n >= a.n) {
+    a = StatsAgg();
+    return;
+  }
+  uint32_t rest = a.n - n;
+  double restMean = (a.n * a.mean - n * mean) / rest;
+  double d = mean - restMean;
+  a.m2 -= m2 + d * d * (double)rest * n / a.n;
+  if (a.m2 < 0) a.m2 = 0;
+  a.mean = restMean;
+  a.n = rest;
+}
+
+// Keeps the deque monotonic: strictly better values push out worse ones
+// at the tail, so the head is always the window extreme.
+static void pushExtreme(StatsExtreme* q, uint8_t head, uint8_t& len, uint32_t seq, float x, bool isMin) {
+  while (len > 0) {
+    StatsExtreme& back = q[(head + len - 1) % QCAP];
+    bool worse = isMin ? back.value >= x : back.value <= x;
+    if (!worse) {
+      if (back.seq == seq) return;   // this slot already holds a better value
+      break;
+    }
+    len--;
+  }
+  q[(head + len) % QCAP] = { seq, x };
+  len++;
+}
+
+static void expireExtremes(StatsExtreme* q, uint8_t& head, uint8_t& len, uint32_t seq) {
+  while (len > 0 && seq - q[head].seq >= STATS_SLOTS) {
+    head = (head + 1) % QCAP;
+    len--;
+  }
+}
+
+static void windowAdd(StatsWindow& w, float x, unsigned long ms, bool started) {
+  if (!started) w.slotStart = ms;
+
+  // Advance one slot at a time, dropping whatever falls out of the window.
+  // After a long gap every slot is stale, so skip ahead in one step.
+  uint32_t steps = (ms - w.slotStart) / w.slotMs;
+  if (steps > STATS_SLOTS) {
+    w.seq += steps - STATS_SLOTS;
+    w.slotStart += (steps - STATS_SLOTS) * w.slotMs;
+    steps = STATS_SLOTS;
+  }
+  while (steps--) {
+    w.seq++;
+    w.slotStart += w.slotMs;
+    w.cur = (w.cur + 1) % STATS_SLOTS;
+    chanRemove(w.total, w.slots[w.cur].n, w.slots[w.cur].mean, w.slots[w.cur].m2);
+    w.slots[w.cur].n = 0;
+    w.slots[w.cur].mean = 0;
+    w.slots[w.cur].m2 = 0;
+  }
+  expireExtremes(w.minQ, w.minHead, w.minLen, w.seq);
+  expireExtremes(w.maxQ, w.maxHead, w.maxLen, w.seq);
+
+  StatsAgg slot = { w.slots[w.cur].n, w.slots[w.cur].mean, w.slots[w.cur].m2 };
+  welfordAdd(slot, x);
+  w.slots[w.cur].n = slot.n;
+  w.slots[w.cur].mean = slot.mean;
+  w.slots[w.cur].m2 = slot.m2;
+  welfordAdd(w.total, x);
+
+  pushExtreme(w.minQ, w.minHead, w.minLen, w.seq, x, true);
+  pushExtreme(w.maxQ, w.maxHead, w.maxLen, w.seq, x, false);
+}
+
+// Called once per sample from updateTemperature(); O(1) amortised
+void statsAdd(float tempC, unsigned long ms, TempStats& s) {
+  for (uint8_t i = 0; i < STATS_WINDOWS; ++i) {
+    windowAdd(s.windows[i], tempC, ms, s.started);
+  }
+
+  welfordAdd(s.sinceBoot, tempC);
+  if (!s.started || tempC < s.bootMin) s.bootMin = tempC;
+  if (!s.started || tempC > s.bootMax) s.bootMax = tempC;
+  s.started = true;
+}
+
+// Back to the state at boot: empty windows, no since-boot extremes
+void statsReset(TempStats& s) {
+  for (uint8_t i = 0; i < STATS_WINDOWS; ++i) {
+    StatsWindow& w = s.windows[i];
+    memset(&w, 0, sizeof(w));
+    w.name = windowDefs[i].name;
+    w.slotMs = windowDefs[i].slotMs;
+  }
+  s.sinceBoot = StatsAgg();
+  s.bootMin = s.bootMax = 0;
+  s.started = false;
+}
+
+static String aggJson(const StatsAgg& a, float mn, float mx) {
+  if (a.n == 0) return "{\"n\":0}";
+  float sd = a.n > 1 ? sqrt(a.m2 / (a.n - 1)) : 0.0f;
+  return "{\"n\":" + String(a.n) +
+         ",\"mean\":" + String(a.mean, 2) +
+         ",\"std\":" + String(sd, 3) +
+         ",\"min\":" + String(mn, 2) +
+         ",\"max\":" + String(mx, 2) + "}";
+}
+
+String statsJson(const TempStats& s) {
+  String json = "{";
+  for (uint8_t i = 0; i < STATS_WINDOWS; ++i) {
+    const StatsWindow& w = s.windows[i];
+    float mn = w.minLen ? w.minQ[w.minHead].value : 0.0f;
+    float mx = w.maxLen ? w.maxQ[w.maxHead].value : 0.0f;
+    json += "\"" + String(w.name) + "\":" + aggJson(w.total, mn, mx) + ",";
+  }
+  json += "\"boot\":" + aggJson(s.sinceBoot, s.bootMin, s.bootMax);
+  json += "}";
+  return json;
+}
@@ -1,30 +1,50 @@
 #include <Arduino.h>
 #include "temperature.h"
+#include "logger.h"
+#include "rules.h"
+#include "temp_series.h"
+#include "temp_stats.h"
+#include "supervisor.h"
+#include "trace_replay.h"
 
 extern "C" uint8_t temprature_sens_read();
 
 float currentTempC = 0.0;
-unsigned long previousMillis = 0;
-const unsigned long interval = 1000;
-float tempBuffer[MAX_TEMP_POINTS];
-unsigned long timeBuffer[MAX_TEMP_POINTS];
-size_t tempIndex = 0;
-bool bufferFull = false;
 
+// One sample; the loop scheduler calls this once a second
 void updateTemperature() {
+  if (replayDrivesRules()) {   // a rules replay owns the rule state and outputs meanwhile
+    superBeat(HB_SAMPLE);
+    return;
+  }
+
   unsigned long currentMillis = millis();
-  
-  if (currentMillis - previousMillis >= interval) {
-    previousMillis = currentMillis;
+  uint8_t raw = temprature_sens_read();
+  traceSample(raw, currentMillis);
+  currentTempC = ingestTemperature(raw, currentMillis, seriesNowDs(), tempSeries, liveStats);
+  LOG_D("Temp: %.2f °C", currentTempC);
+  superBeat(HB_SAMPLE);
+}
 
-    uint8_t raw = temprature_sens_read();
-    currentTempC = (raw - 32) / 1.8;
-    Serial.printf("Temp: %.2f °C\n", currentTempC);
+// Everything downstream of the sensor read, into the given series and
+// stats. Time comes in as arguments so a replay can drive it from a
+// recorded clock; stageUs (INGEST_STAGES entries) accumulates the cost of
+// each stage when given.
+float ingestTemperature(uint8_t raw, unsigned long ms, uint32_t ds, TempSeries& series, TempStats& stats,
+                        bool rules, uint32_t* stageUs) {
+  float tempC = (raw - 32) / 1.8;
 
-    tempBuffer[tempIndex] = currentTempC;
-    timeBuffer[tempIndex] = currentMillis;
+  uint32_t t0 = micros();
+  if (rules) evaluateRules(tempC, ms);
+  uint32_t t1 = micros();
+  series.append(ds, lroundf(tempC * 100));
+  uint32_t t2 = micros();
+  statsAdd(tempC, ms, stats);
 
-    tempIndex = (tempIndex + 1) % MAX_TEMP_POINTS;
-    if (tempIndex == 0) bufferFull = true;
+  if (stageUs) {
+    stageUs[INGEST_RULES] += t1 - t0;
+    stageUs[INGEST_SERIES] += t2 - t1;
+    stageUs[INGEST_STATS] += micros() - t2;
   }
+  return tempC;
 }
\ No newline at end of file
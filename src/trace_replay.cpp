@@ -0,0 +1,317 @@
+#include <Arduino.h>
+#include "trace_replay.h"
+#include "fs_spiffs.h"
+#include "temperature.h"
+#include "temp_series.h"
+#include "temp_stats.h"
+#include "gpio_control.h"
+#include "loop_scheduler.h"
+#include "web_server.h"
+#include "logger.h"
+#include "mem_pool.h"
+#include "rom/crc.h"
+#include <new>
+
+// Indexed by TraceRequest; capture matches on these, replay reports under them
+static const char* const requestNames[REQ_COUNT] = {
+  "/status", "/stats", "/history", "/history/stats", "/topics", "/loop", "/", "ws:getStatus"
+};
+static const char* const stageNames[INGEST_STAGES] = { "rules", "series", "stats" };
+
+// Capture and replay never run together, so they share one record buffer
+static TraceRecord buf[TRACE_BUF_RECORDS];
+static uint8_t bufLen;
+static uint8_t bufPos;
+
+static File captureFile;
+static bool capturing;
+static uint32_t captureStart;
+static uint32_t captureRecords;
+static File uploadFile;
+
+static File replayFile;
+static TempSeries* scratchSeries;     // the replay's own history and stats, never the live ones
+static TempStats* scratchStats;
+static struct {
+  bool running;
+  bool holding;
+  bool rules;
+  uint32_t total;           // records in the file
+  uint32_t records;         // records processed so far
+  uint32_t samples;
+  uint32_t virtualMs;       // recorded clock at the last record
+  uint64_t wallUs;          // time actually spent replaying
+  uint32_t stageUs[INGEST_STAGES];
+  uint32_t reqCount[REQ_COUNT];
+  uint32_t reqUs[REQ_COUNT];
+  uint32_t reqMaxUs[REQ_COUNT];
+  uint32_t reqBytes[REQ_COUNT];
+  uint32_t digest;          // series contents and window stats at the end
+} rp;
+
+/* ========== Capture ========== */
+
+// False once the filesystem is too full to keep going
+static bool captureFlush() {
+  if (bufLen > 0) {
+    captureFile.write((const uint8_t*)buf, bufLen * sizeof(TraceRecord));
+    bufLen = 0;
+  }
+  return APP_FS.totalBytes() - APP_FS.usedBytes() >= TRACE_MIN_FREE;
+}
+
+static void captureAdd(uint8_t kind, uint8_t arg, unsigned long ms) {
+  buf[bufLen++] = { (uint32_t)(ms - captureStart), kind, arg };
+  captureRecords++;
+  if (bufLen == TRACE_BUF_RECORDS && !captureFlush()) {
+    LOG_W("Trace capture stopped, filesystem nearly full");
+    traceCapture(false);
+  }
+}
+
+void traceCapture(bool on) {
+  if (on == capturing || (on && replayActive())) return;
+
+  if (on) {
+    captureFile = fsMounted() ? APP_FS.open(TRACE_PATH, FILE_WRITE) : File();
+    if (!captureFile) {
+      LOG_W("Trace capture: cannot open %s", TRACE_PATH);
+      return;
+    }
+    bufLen = 0;
+    captureRecords = 0;
+    captureStart = millis();
+    capturing = true;
+    LOG_I("Trace capture started");
+  } else {
+    captureFlush();
+    captureFile.close();
+    capturing = false;
+    LOG_I("Trace capture stopped, %u records", captureRecords);
+  }
+}
+
+void traceSample(uint8_t raw, unsigned long ms) {
+  if (capturing) captureAdd(TRACE_SAMPLE, raw, ms);
+}
+
+void traceRequest(const char* route) {
+  if (!capturing) return;
+  for (uint8_t i = 0; i < REQ_COUNT; ++i) {
+    if (strcmp(route, requestNames[i]) == 0) {
+      captureAdd(TRACE_REQUEST, i, millis());
+      return;
+    }
+  }
+}
+
+// Fed from the /trace upload handler; a trailing partial record is ignored on replay
+bool traceUpload(const uint8_t* data, size_t len, bool first, bool last) {
+  if (first) {
+    if (capturing || replayActive() || !fsMounted()) return false;
+    uploadFile = APP_FS.open(TRACE_PATH, FILE_WRITE);
+  }
+  if (!uploadFile) return false;
+  bool ok = len == 0 || uploadFile.write(data, len) == len;
+  if (last || !ok) uploadFile.close();
+  return ok;
+}
+
+String traceJson() {
+  uint32_t bytes = captureRecords * sizeof(TraceRecord);
+  if (!capturing) {
+    File f = fsMounted() ? APP_FS.open(TRACE_PATH) : File();
+    bytes = f ? f.size() : 0;
+    if (f) f.close();
+  }
+  return "{\"path\":\"" TRACE_PATH "\",\"capturing\":" + String(capturing ? "true" : "false") +
+         ",\"records\":" + String(bytes / sizeof(TraceRecord)) +
+         ",\"bytes\":" + String(bytes) + "}";
+}
+
+/* ========== Replay ========== */
+
+// Same formatting and pooled buffer as handleHistory(), with nowhere to send it
+static size_t renderHistory() {
+  char* out = (char*)scratchPool.take();
+  if (!out) return 0;
+  TempSeries::Reader r = scratchSeries->reader();
+  size_t bytes = 2, n;
+  while ((n = seriesJsonChunk(r, out, POOL_SCRATCH_SIZE)) > 0) bytes += n + 1;
+  scratchPool.give(out);
+  return bytes;
+}
+
+static size_t renderRequest(uint8_t req) {
+  switch (req) {
+    case REQ_STATUS:
+    case REQ_WS_STATUS:     return statusJson().length();
+    case REQ_STATS:         return statsJson(*scratchStats).length();
+    case REQ_HISTORY:       return renderHistory();
+    case REQ_HISTORY_STATS: return seriesStatsJson().length();
+    case REQ_TOPICS:        return topicsJson().length();
+    case REQ_LOOP:          return loopJobsJson().length();
+    case REQ_PAGE:          return SendHTML(LED1status, LED2status).length();
+  }
+  return 0;
+}
+
+// Everything a replay leaves behind that should not depend on how fast it ran
+static uint32_t replayDigest() {
+  uint32_t crc = 0;
+  TempSeries::Reader r = scratchSeries->reader();
+  uint32_t t;
+  int16_t v;
+  while (r.next(t, v)) {
+    crc = crc32_le(crc, (const uint8_t*)&t, sizeof(t));
+    crc = crc32_le(crc, (const uint8_t*)&v, sizeof(v));
+  }
+  String stats = statsJson(*scratchStats);
+  return crc32_le(crc, (const uint8_t*)stats.c_str(), stats.length());
+}
+
+static void replayFree() {
+  delete scratchSeries;
+  delete scratchStats;
+  scratchSeries = nullptr;
+  scratchStats = nullptr;
+}
+
+bool replayActive() {
+  return rp.running || rp.holding;
+}
+
+bool replayDrivesRules() {
+  return rp.running && rp.rules;
+}
+
+const TempSeries* replaySeries() {
+  return scratchSeries;
+}
+
+bool replayStart(bool rules, bool hold, String& error) {
+  if (rp.running) { error = "replay already running"; return false; }
+  if (capturing) { error = "capture in progress"; return false; }
+  if (!fsMounted()) { error = "filesystem not mounted yet"; return false; }
+
+  replayFile = APP_FS.open(TRACE_PATH);
+  if (!replayFile || replayFile.size() < sizeof(TraceRecord)) {
+    if (replayFile) replayFile.close();
+    error = "no trace at " TRACE_PATH;
+    return false;
+  }
+
+  // Fresh and empty, as at boot, on every run; a held result is dropped
+  replayFree();
+  scratchSeries = new (std::nothrow) TempSeries();
+  scratchStats = new (std::nothrow) TempStats();
+  if (!scratchSeries || !scratchStats) {
+    replayFree();
+    replayFile.close();
+    error = "not enough memory for a scratch history";
+    return false;
+  }
+
+  memset(&rp, 0, sizeof(rp));
+  rp.total = replayFile.size() / sizeof(TraceRecord);
+  rp.rules = rules;
+  rp.holding = hold;
+  rp.running = true;
+  bufLen = 0;
+  bufPos = 0;
+  LOG_I("Replay started: %u records", rp.total);
+  return true;
+}
+
+static void replayFinish() {
+  rp.running = false;
+  replayFile.close();
+  rp.digest = replayDigest();
+  if (!rp.holding) replayFree();
+  LOG_I("Replay done: %u records in %u ms", rp.records, (uint32_t)(rp.wallUs / 1000));
+}
+
+void replayStop() {
+  if (rp.running) replayFile.close();
+  replayFree();
+  rp.running = false;
+  rp.holding = false;
+}
+
+// Loop job: as many records as fit in one slice, on the recorded clock
+void replayStep() {
+  if (!rp.running) return;
+  uint32_t start = micros();
+
+  while (micros() - start < REPLAY_SLICE_US) {
+    if (bufPos == bufLen) {
+      bufLen = replayFile.read((uint8_t*)buf, sizeof(buf)) / sizeof(TraceRecord);
+      bufPos = 0;
+      if (bufLen == 0) {
+        rp.wallUs += micros() - start;
+        replayFinish();
+        return;
+      }
+    }
+
+    const TraceRecord& rec = buf[bufPos++];
+    rp.records++;
+    rp.virtualMs = rec.ms;
+
+    if (rec.kind == TRACE_SAMPLE) {
+      ingestTemperature(rec.arg, rec.ms, rec.ms / 100, *scratchSeries, *scratchStats, rp.rules, rp.stageUs);
+      rp.samples++;
+    } else if (rec.kind == TRACE_REQUEST && rec.arg < REQ_COUNT) {
+      uint32_t t0 = micros();
+      rp.reqBytes[rec.arg] += renderRequest(rec.arg);
+      uint32_t took = micros() - t0;
+      rp.reqCount[rec.arg]++;
+      rp.reqUs[rec.arg] += took;
+      if (took > rp.reqMaxUs[rec.arg]) rp.reqMaxUs[rec.arg] = took;
+    }
+  }
+  rp.wallUs += micros() - start;
+}
+
+String replayJson() {
+  uint32_t wallMs = rp.wallUs / 1000;
+  String json = "{\"running\":" + String(rp.running ? "true" : "false") +
+                ",\"hold\":" + String(rp.holding ? "true" : "false") +
+                ",\"rules\":" + String(rp.rules ? "true" : "false") +
+                ",\"records\":" + String(rp.records) +
+                ",\"total\":" + String(rp.total) +
+                ",\"samples\":" + String(rp.samples) +
+                ",\"virtual_ms\":" + String(rp.virtualMs) +
+                ",\"wall_ms\":" + String(wallMs) +
+                ",\"speedup\":" + String(wallMs ? (float)rp.virtualMs / wallMs : 0.0f, 1);
+  if (!rp.running && rp.records) {
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08x", rp.digest);
+    json += ",\"digest\":\"" + String(hex) + "\"";
+  }
+  if (scratchStats) {
+    json += ",\"series_samples\":" + String(scratchSeries->size());
+    json += ",\"stats\":" + statsJson(*scratchStats);
+  }
+
+  json += ",\"stages\":{";
+  for (uint8_t i = 0; i < INGEST_STAGES; ++i) {
+    if (i > 0) json += ",";
+    json += "\"" + String(stageNames[i]) + "\":{\"us\":" + String(rp.stageUs[i]) +
+            ",\"avg_us\":" + String(rp.samples ? rp.stageUs[i] / rp.samples : 0) + "}";
+  }
+  json += "},\"requests\":{";
+  bool first = true;
+  for (uint8_t i = 0; i < REQ_COUNT; ++i) {
+    if (rp.reqCount[i] == 0) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "\"" + String(requestNames[i]) + "\":{\"n\":" + String(rp.reqCount[i]) +
+            ",\"us\":" + String(rp.reqUs[i]) +
+            ",\"avg_us\":" + String(rp.reqUs[i] / rp.reqCount[i]) +
+            ",\"max_us\":" + String(rp.reqMaxUs[i]) +
+            ",\"bytes\":" + String(rp.reqBytes[i]) + "}";
+  }
+  json += "}}";
+  return json;
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
+#include "udp_export.h"
+#include "temp_series.h"
+#include "gpio_control.h"
+#include "utilities.h"
+#include "logger.h"
+#include "link_monitor.h"
+#include "trace_replay.h"
+
+extern unsigned long bootMillis;
+
+static UdpConfig cfg;
+static WiFiUDP udp;
+Preferences prefs_udp;
+
+static uint8_t packet[sizeof(UdpHeader) + UDP_MAX_SAMPLES * sizeof(UdpSample)];
+static uint32_t seq = 0;
+static uint32_t lastSendMs = 0;
+static bool draining = false;
+static uint32_t lastSentT = 0;      // newest sample already exported
+static bool anySent = false;
+static uint32_t sent = 0;
+static uint32_t failed = 0;
+static uint32_t samplesSent = 0;
+static uint32_t samplesDropped = 0; // fell out of the series before they could be sent
+
+static void saveUdpConfig() {
+  prefs_udp.begin("udp", false);
+  prefs_udp.putBytes("cfg", &cfg, sizeof(cfg));
+  prefs_udp.end();
+}
+
+void initUdpExport() {
+  prefs_udp.begin("udp", true);
+  size_t len = prefs_udp.getBytes("cfg", &cfg, sizeof(cfg));
+  prefs_udp.end();
+
+  if (len != sizeof(cfg)) {
+    cfg.ip = 0;
+    cfg.port = UDP_DEFAULT_PORT;
+    cfg.intervalMs = UDP_DEFAULT_INTERVAL_MS;
+    cfg.enabled = 0;
+  }
+}
+
+// Empty host, port 0, interval 0 and enable -1 each keep the current setting
+bool udpConfigure(const String& host, uint16_t port, uint32_t intervalMs, int8_t enable) {
+  IPAddress ip;
+  if (host.length() && !ip.fromString(host)) return false;
+  if (intervalMs && intervalMs < UDP_MIN_INTERVAL_MS) return false;
+
+  if (host.length()) cfg.ip = (uint32_t)ip;
+  if (port) cfg.port = port;
+  if (intervalMs) cfg.intervalMs = intervalMs;
+  if (enable >= 0) cfg.enabled = enable;
+  if (cfg.ip == 0) cfg.enabled = 0;
+  saveUdpConfig();
+  LOG_I("UDP export %s -> %S:%u", cfg.enabled ? "on" : "off", IPAddress(cfg.ip).toString(), (unsigned)cfg.port);
+  return true;
+}
+
+// The next UDP_MAX_SAMPLES after the cursor, as far as a 16-bit offset
+// from t0 reaches; last is the newest one packed and dropped the gap in
+// front of the first. Before the first datagram the cursor starts at the
+// newest UDP_MAX_SAMPLES.
+static uint16_t packSamples(UdpHeader& h, UdpSample* out, uint32_t& last, uint32_t& dropped) {
+  bool fromStart = true;
+  uint32_t size = tempSeries.size();
+  TempSeries::Reader r = anySent ? tempSeries.readerAfter(lastSentT, fromStart)
+                                 : tempSeries.reader(size > UDP_MAX_SAMPLES ? size - UDP_MAX_SAMPLES : 0);
+  uint16_t count = 0;
+  uint32_t t;
+  int16_t v;
+  while (count < UDP_MAX_SAMPLES && r.next(t, v)) {
+    if (anySent && t <= lastSentT) continue;
+    if (count == 0) h.t0 = t;
+    if (t - h.t0 > 0xFFFF) break;
+    out[count].dtDs = t - h.t0;
+    out[count].vCenti = v;
+    count++;
+    last = t;
+  }
+  // The oldest sample still held is newer than the gap after the cursor
+  if (count && anySent && fromStart && h.t0 > lastSentT + 2 * SERIES_NOMINAL_DS) {
+    dropped = (h.t0 - lastSentT) / SERIES_NOMINAL_DS - 1;
+  }
+  return count;
+}
+
+// One datagram; returns how many samples it carried, -1 if it was not sent
+static int sendDatagram() {
+  UdpHeader& h = *(UdpHeader*)packet;
+  memset(&h, 0, sizeof(h));
+  h.magic = UDP_MAGIC;
+  h.version = UDP_VERSION;
+  h.flags = (LED1status ? UDP_FLAG_LED1 : 0) | (LED2status ? UDP_FLAG_LED2 : 0);
+  h.seq = seq++;
+  h.uptimeS = getUptimeMillis(bootMillis) / 1000;
+  h.heapFree = ESP.getFreeHeap();
+  h.heapMinFree = ESP.getMinFreeHeap();
+  h.rssi = linkRssi();
+
+  // A replay's readings are not this board's; the cursor waits it out
+  uint32_t last = lastSentT, dropped = 0;
+  h.count = replayActive() ? 0 : packSamples(h, (UdpSample*)(packet + sizeof(UdpHeader)), last, dropped);
+
+  size_t len = sizeof(UdpHeader) + h.count * sizeof(UdpSample);
+  if (!udp.beginPacket(IPAddress(cfg.ip), cfg.port) || udp.write(packet, len) != len || !udp.endPacket()) {
+    failed++;
+    return -1;
+  }
+  sent++;
+  samplesSent += h.count;
+  samplesDropped += dropped;
+  if (h.count) {
+    lastSentT = last;
+    anySent = true;
+  }
+  return h.count;
+}
+
+// Loop job; one datagram per configured interval while on the STA network,
+// then up to UDP_FLUSH_DATAGRAMS per pass until a backlog is through
+void udpExportStep() {
+  if (!cfg.enabled || !linkStaUp()) return;
+  uint32_t now = millis();
+  if (!draining && now - lastSendMs < cfg.intervalMs) return;
+  if (!draining) lastSendMs = now;
+  draining = false;
+
+  for (uint8_t i = 0; i < UDP_FLUSH_DATAGRAMS; ++i) {
+    if (sendDatagram() < UDP_MAX_SAMPLES) break;
+    if (i == UDP_FLUSH_DATAGRAMS - 1) draining = true;   // more left; carry on next pass
+  }
+}
+
+String udpJson() {
+  String json = "{\"enabled\":" + String(cfg.enabled ? "true" : "false");
+  json += ",\"host\":\"" + IPAddress(cfg.ip).toString() + "\"";
+  json += ",\"port\":" + String(cfg.port);
+  json += ",\"interval_ms\":" + String(cfg.intervalMs);
+  json += ",\"seq\":" + String(seq);
+  json += ",\"sent\":" + String(sent);
+  json += ",\"failed\":" + String(failed);
+  json += ",\"samples\":" + String(samplesSent);
+  json += ",\"dropped_samples\":" + String(samplesDropped);
+  json += "}";
+  return json;
+}
\ No newline at end of file
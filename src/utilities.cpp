@@ -1,6 +1,23 @@
 #include <Arduino.h>
+#include <time.h>
 #include "utilities.h"
 
 unsigned long getUptimeMillis(unsigned long bootMillis) {
     return millis() - bootMillis;
-  }
\ No newline at end of file
+  }
+
+// Milliseconds until the next local HH:MM, or -1 while the wall clock
+// has not been set by SNTP yet.
+long msUntilTimeOfDay(int hour, int minute) {
+  time_t now = time(NULL);
+  struct tm local;
+
+  if (now < 1600000000) return -1;
+
+  localtime_r(&now, &local);
+  long nowSec = local.tm_hour * 3600L + local.tm_min * 60L + local.tm_sec;
+  long targetSec = hour * 3600L + minute * 60L;
+  long wait = targetSec - nowSec;
+  if (wait <= 0) wait += 24L * 3600L;
+  return wait * 1000L;
+}
@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "rom/crc.h"
+#include "warm_restart.h"
+#include "temp_series.h"
+#include "gpio_control.h"
+#include "utilities.h"
+
+extern unsigned long bootMillis;
+
+RTC_NOINIT_ATTR static WarmHeader warm;
+
+static bool restored = false;
+static uint32_t restoreUs = 0;
+static esp_reset_reason_t resetReason;
+
+static uint32_t layoutTag() {
+  return WARM_VERSION | (sizeof(WarmHeader) << 8) | ((uint32_t)sizeof(TempSeries) << 16);
+}
+
+static uint32_t warmCrc() {
+  const uint8_t* fields = (const uint8_t*)&warm.warmRestores;
+  uint32_t crc = crc32_le(0, fields, sizeof(WarmHeader) - offsetof(WarmHeader, warmRestores));
+  return crc32_le(crc, (const uint8_t*)&tempSeries, sizeof(TempSeries));
+}
+
+/*
+Use :
+  Call first thing in setup(). Returns true when the previous run handed
+  over its state through warmSave(); otherwise the retained series is
+  reset and the caller falls back to NVS.
+*/
+bool warmRestore() {
+  int64_t start = esp_timer_get_time();
+  resetReason = esp_reset_reason();
+
+  // Only a software restart can have gone through warmSave(); power-on and
+  // brownout leave RTC memory contents undefined, and a panic or
+  // watchdog reset may have stopped mid-update.
+  restored = resetReason == ESP_RST_SW &&
+             warm.magic == WARM_MAGIC &&
+             warm.layout == layoutTag() &&
+             warm.crc == warmCrc();
+
+  initTempSeries(restored);
+  if (restored) {
+    LED1status = warm.led1;
+    LED2status = warm.led2;
+    warm.warmRestores++;
+  } else {
+    warm.warmRestores = 0;
+    warm.uptimeBaseS = 0;
+  }
+
+  // Any later reset that skips warmSave() must start cold
+  warm.magic = 0;
+  restoreUs = esp_timer_get_time() - start;
+  return restored;
+}
+
+// Call right before a planned ESP.restart(), after the last sample is in
+void warmSave() {
+  warm.layout = layoutTag();
+  warm.uptimeBaseS += getUptimeMillis(bootMillis) / 1000;
+  warm.led1 = LED1status;
+  warm.led2 = LED2status;
+  warm.crc = warmCrc();
+  warm.magic = WARM_MAGIC;
+}
+
+String warmJson() {
+  String json = "{";
+  json += "\"reset_reason\":" + String((int)resetReason) + ",";
+  json += "\"restored\":" + String(restored ? "true" : "false") + ",";
+  json += "\"restore_us\":" + String(restoreUs) + ",";
+  json += "\"warm_restores\":" + String(warm.warmRestores) + ",";
+  json += "\"uptime_total\":" + String(warm.uptimeBaseS + getUptimeMillis(bootMillis) / 1000);
+  json += "}";
+  return json;
+}
@@ -6,164 +6,358 @@
 #include "gpio_control.h"
 #include "temperature.h"
 #include "utilities.h"
+#include "boot_profile.h"
+#include "logger.h"
+#include "sse_events.h"
+#include "metrics.h"
+#include "rules.h"
+#include "gpio_schedule.h"
+#include "pwm_control.h"
+#include "fs_spiffs.h"
+#include "temp_series.h"
+#include "temp_stats.h"
+#include "ws_topics.h"
+#include "warm_restart.h"
+#include "html_template.h"
+#include "loop_scheduler.h"
+#include "supervisor.h"
+#include "trace_replay.h"
+#include "admission.h"
+#include "udp_export.h"
+#include "mqtt_client.h"
+#include "link_monitor.h"
+#include "http_range.h"
+#include "hub.h"
+#include "mem_pool.h"
 #include <Update.h>
 #include <Preferences.h>
 #include "esp_partition.h"
 #include "esp_ota_ops.h"
 
 Preferences prefs_ota;
-WebServer server(80);
+HandoffWebServer server(80);
 WebSocketsServer webSocket(81);
 
-static int lastRSSI = 0;
-unsigned long lastPush = 0;
-const int rssiThreshold = 5;
+unsigned long lastStatsPush = 0;
+uint32_t logCursor = 0;
 bool shouldReboot = false;
 String firmwareVersion = String(FW_VERSION) + " (" + String(__DATE__) + " " + String(__TIME__) + ")";
 
 extern unsigned long bootMillis;
-extern float tempBuffer[MAX_TEMP_POINTS];
-extern unsigned long timeBuffer[MAX_TEMP_POINTS];
-extern size_t tempIndex;
-extern bool bufferFull;
 
 void initWebServer() {
-  server.on("/", handle_OnConnect);
-  server.on("/led1on", handle_led1on);
-  server.on("/led1off", handle_led1off);
-  server.on("/led2on", handle_led2on);
-  server.on("/led2off", handle_led2off);
-  server.on("/temperature", handle_temperature);
-  server.on("/status", []() {
+  server.on("/", timedRoute("/", handle_OnConnect));
+  server.on("/led1on", timedRoute("/led1on", handle_led1on));
+  server.on("/led1off", timedRoute("/led1off", handle_led1off));
+  server.on("/led2on", timedRoute("/led2on", handle_led2on));
+  server.on("/led2off", timedRoute("/led2off", handle_led2off));
+  server.on("/temperature", timedRoute("/temperature", handle_temperature));
+  server.on("/status", timedRoute("/status", []() {
     String json = "{";
     json += "\"led1\":" + String(LED1status ? "true" : "false") + ",";
-    json += "\"led2\":" + String(LED2status ? "true" : "false");
-    json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000);
+    json += "\"led2\":" + String(LED2status ? "true" : "false") + ",";
+    json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000) + ",";
+    json += "\"boot\":" + bootProfileJson() + ",";
+    json += "\"warm\":" + warmJson();
     json += "}";
     server.send(200, "application/json", json);
+  }));
+  server.on("/gpio", timedRoute("/gpio", handleGPIOControl));
+  server.on("/pwm", timedRoute("/pwm", handlePWMControl));
+  server.on("/page_stats", HTTP_GET, timedRoute("/page_stats", []() {
+    server.send(200, "application/json", pageStatsJson());
+  }));
+  server.on("/loop", HTTP_GET, timedRoute("/loop", []() {
+    server.send(200, "application/json", loopJobsJson());
+  }));
+  server.on("/stall_report", HTTP_GET, timedRoute("/stall_report", []() {
+    server.send(200, "application/json", stallReportJson());
+  }));
+  server.on("/trace", HTTP_GET, timedRoute("/trace", []() {
+    if (server.hasArg("capture")) traceCapture(server.arg("capture") == "1");
+    server.send(200, "application/json", traceJson());
+  }));
+  // Timed once per upload, on completion; the body callback runs per received buffer
+  server.on("/trace", HTTP_POST, timedRoute("/trace:upload", []() {
+    server.send(200, "application/json", traceJson());
+  }), []() {
+    HTTPUpload& upload = server.upload();
+    bool ok = true;
+    if (upload.status == UPLOAD_FILE_START) ok = traceUpload(nullptr, 0, true, false);
+    else if (upload.status == UPLOAD_FILE_WRITE) ok = traceUpload(upload.buf, upload.currentSize, false, false);
+    else if (upload.status == UPLOAD_FILE_END) ok = traceUpload(nullptr, 0, false, true);
+    if (!ok) LOG_W("Trace upload failed");
+  });
+  server.on("/replay", HTTP_GET, timedRoute("/replay", handleReplay));
+  server.on("/udp", timedRoute("/udp", handleUdpExport));
+  server.on("/mqtt", timedRoute("/mqtt", handleMqtt));
+  server.on("/hub", HTTP_GET, timedRoute("/hub", handleHubPage));
+  server.on("/hub/peers", timedRoute("/hub/peers", handleHubPeers));
+  server.on("/hub/history", HTTP_GET, timedRoute("/hub/history", handleHubHistory));
+  server.on("/link", HTTP_GET, timedRoute("/link", []() {
+    server.send(200, "application/json", linkJson());
+  }));
+  server.on("/admission", HTTP_GET, timedRoute("/admission", []() {
+#ifdef ADMISSION_LOAD_TEST
+    if (server.hasArg("unlimit")) admissionUnlimit(max(0L, server.arg("unlimit").toInt()));
+#endif
+    server.send(200, "application/json", admissionJson());
+  }));
+  server.on("/stats", HTTP_GET, timedRoute("/stats", []() {
+    server.send(200, "application/json", statsJson());
+  }));
+  server.on("/topics", HTTP_GET, timedRoute("/topics", []() {
+    server.send(200, "application/json", topicsJson());
+  }));
+  server.on("/history", HTTP_GET, timedRoute("/history", handleHistory));
+  server.on("/history/stats", HTTP_GET, timedRoute("/history/stats", []() {
+    String bench = server.arg("bench");
+    server.send(200, "application/json", seriesStatsJson(bench.length() ? bench.c_str() : nullptr));
+  }));
+  server.on("/file", HTTP_GET, timedRoute("/file", handleFileDownload));
+  server.on("/partition", HTTP_GET, timedRoute("/partition", handlePartitionDownload));
+  server.on("/fs_info", HTTP_GET, timedRoute("/fs_info", []() {
+    String bench = server.arg("bench");
+    server.send(200, "application/json", fsInfoJson(bench.length() ? bench.c_str() : nullptr));
+  }));
+  server.on("/schedule", timedRoute("/schedule", handleSchedule));
+  server.on("/schedule/list", HTTP_GET, timedRoute("/schedule/list", []() {
+    server.send(200, "application/json", schedulesJson());
+  }));
+  server.on("/schedule/cancel", timedRoute("/schedule/cancel", []() {
+    if (!server.hasArg("id") || !cancelSchedule(server.arg("id").toInt())) {
+      server.send(404, "text/plain", "No such schedule");
+      return;
+    }
+    server.send(200, "application/json", schedulesJson());
+  }));
+  server.on("/rules", HTTP_GET, timedRoute("/rules", handleRules));
+  server.on("/rules/add", timedRoute("/rules/add", handleRuleAdd));
+  server.on("/rules/delete", timedRoute("/rules/delete", handleRuleDelete));
+  server.on("/rules/clear", timedRoute("/rules/clear", []() {
+    clearRules();
+    server.send(200, "application/json", rulesJson());
+  }));
+  server.on("/events", HTTP_GET, timedRoute("/events", handleEventsConnect));
+  server.on("/metrics", HTTP_GET, []() {
+    String json = metricsJson();
+    if (server.arg("reset") == "1") metricsReset();
+    server.send(200, "application/json", json);
   });
-  server.on("/gpio", handleGPIOControl);
+  server.on("/logs", timedRoute("/logs", []() {
+    server.sendHeader("X-Log-Dropped", String(logDroppedCount()));
+    server.send(200, "text/plain", recentLogs());
+  }));
   
   server.on("/favicon.ico", []() {
     server.send(204);
   });
 
   server.onNotFound([]() {
-    Serial.print("404 Not Found: ");
-    Serial.println(server.uri());
+    LOG_W("404 Not Found: %S", server.uri());
     server.send(404, "text/plain", "Not found");
   });
 
   if (prefs_ota.begin("ota", false)) {
     if (!prefs_ota.isKey("version_factory")) {
       prefs_ota.putString("version_factory", firmwareVersion);
-      Serial.println("✅ Factory version stored: " + firmwareVersion);
+      LOG_I("Factory version stored: %s", firmwareVersion.c_str());
     } else {
-      Serial.println("ℹ️ Factory version already exists.");
+      LOG_I("Factory version already exists.");
     }
     prefs_ota.end();
   } else {
-    Serial.println("❌ Failed to init OTA preferences.");
+    LOG_E("Failed to init OTA preferences.");
   } 
   
+  initRangeHeaders(server);
   server.begin();
-  Serial.println("HTTP server started");
+  LOG_I("HTTP server started");
+}
+
+
+// Clients whose history was held back by admission control
+static uint8_t historyPending = 0;
+
+// Replayed as ~1 KB parts, each a complete {"history":[...]} frame built
+// in one pooled block; the dashboard appends them in order. False when no
+// frame is free, and the caller defers it like any other shortage.
+static bool sendHistory(uint8_t num) {
+  static const char head[] = "{\"history\":[";
+  const size_t headLen = sizeof(head) - 1;
+
+  uint8_t* frame = (uint8_t*)framePool.take();
+  if (!frame) return false;
+
+  uint32_t count = min<uint32_t>(tempSeries.size(), MAX_TEMP_POINTS);
+  TempSeries::Reader r = tempSeries.reader(tempSeries.size() - count);
+  char* out = (char*)frame + WS_FRAME_HEADROOM;
+  memcpy(out, head, headLen);
+
+  size_t n;
+  while ((n = seriesJsonChunk(r, out + headLen, WS_FRAME_PAYLOAD - headLen - 2)) > 0) {
+    size_t len = headLen + n;
+    out[len++] = ']';
+    out[len++] = '}';
+    wsSendPooled(num, frame, len);
+  }
+  framePool.give(frame);
+  return true;
 }
 
 void initWebSocket() {
+  static int8_t wsConnectMetric = metricsRegister("ws:connect");
+  static int8_t wsTextMetric = metricsRegister("ws:text");
+
   webSocket.begin();
   webSocket.onEvent([](uint8_t num, WStype_t type, uint8_t * payload, size_t length) {
-    if (type == WStype_CONNECTED) {
-      String historyJson = "[";
-      size_t start = bufferFull ? tempIndex : 0;
-      size_t count = bufferFull ? MAX_TEMP_POINTS : tempIndex;
-
-      for (size_t i = 0; i < count; ++i) {
-        size_t idx = (start + i) % MAX_TEMP_POINTS;
-        float seconds = timeBuffer[idx] / 1000.0;
-        historyJson += "{\"time\":" + String(seconds, 1) + ",\"temp\":" + String(tempBuffer[idx], 2) + "}";
-        if (i < count - 1) historyJson += ",";
+    const char* prev = superEnter("ws:event");
+    uint32_t start = micros();
+
+    uint32_t retryS;
+    if (type == WStype_CONNECTED && !admitWebSocket(webSocket.remoteIP(num), retryS)) {
+      String busy = "{\"busy\":true,\"retry_after\":" + String(retryS) + "}";
+      webSocket.sendTXT(num, busy.c_str(), busy.length());
+      webSocket.disconnect(num);
+    }
+
+    else if (type == WStype_CONNECTED) {
+      topicsConnected(num, (const char*)payload);
+      if (topicsWantsHistory(num)) {
+        if (!admitHistory() || !sendHistory(num)) {
+          historyPending |= 1 << num;
+          admissionHistoryDeferred(false);
+        }
       }
-      historyJson += "]";
-      webSocket.sendTXT(num, "{\"history\":" + historyJson + "}");
+    }
+
+    else if (type == WStype_DISCONNECTED) {
+      historyPending &= ~(1 << num);
+      topicsDisconnected(num);
     }
 
     else if (type == WStype_TEXT) {
       String msg = (char*)payload;
-      if (msg == "getStatus") {
-        String json = "{";
-        json += "\"led1\":" + String(LED1status ? "true" : "false") + ",";
-        json += "\"led2\":" + String(LED2status ? "true" : "false") + ",";
-        json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000) + ",";
-        json += "\"ap_ip\":\"" + WiFi.softAPIP().toString() + "\",";
-        json += "\"sta_ip\":\"" + WiFi.localIP().toString() + "\",";
-        json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
-        json += "\"clients\":" + String(WiFi.softAPgetStationNum());
-        json += "}";
-        webSocket.sendTXT(num, json);
+      if (topicsHandleMessage(num, msg)) {}
+      else if (msg == "getStatus") {
+        traceRequest("ws:getStatus");
+        wsSend(num, statusJson());
       }
+      // Toggles ride the already-open socket; the resulting broadcast is the reply
+      else if (msg == "led1on") setLed(1, true);
+      else if (msg == "led1off") setLed(1, false);
+      else if (msg == "led2on") setLed(2, true);
+      else if (msg == "led2off") setLed(2, false);
     }
+
+    if (type == WStype_CONNECTED) metricsRecord(wsConnectMetric, micros() - start);
+    else if (type == WStype_TEXT) metricsRecord(wsTextMetric, micros() - start);
+    superLeave(prev);
   });
 }
 
-void handleClients() {
-  unsigned long now;
-  int currentRSSI;
+String statusJson() {
+  String json = "{";
+  json += "\"led1\":" + String(LED1status ? "true" : "false") + ",";
+  json += "\"led2\":" + String(LED2status ? "true" : "false") + ",";
+  json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000) + ",";
+  json += "\"ap_ip\":\"" + WiFi.softAPIP().toString() + "\",";
+  json += "\"sta_ip\":\"" + WiFi.localIP().toString() + "\",";
+  json += "\"rssi\":" + String(linkRssi()) + ",";
+  json += "\"clients\":" + String(linkApClients()) + ",";
+  json += "\"stats\":" + statsJson() + ",";
+  json += "\"pools\":" + poolsJson();
+  json += "}";
+  return json;
+}
 
+// Every live update goes through here so WebSocket and SSE clients see
+// the same serialized frame; WebSocket clients only get their topics.
+void broadcastEvent(const String& json, WsTopic topic) {
+  topicsPublish(topic, json);
+  sseBroadcast(json);
+  mqttPublishEvent(topic, json);
+}
+
+static String jsonEscape(const String& in) {
+  String out;
+  out.reserve(in.length() + 8);
+  for (size_t i = 0; i < in.length(); ++i) {
+    char c = in[i];
+    if (c == '"' || c == '\\') { out += '\\'; out += c; }
+    else if (c == '\n') out += "\\n";
+    else if ((uint8_t)c >= 0x20) out += c;
+  }
+  return out;
+}
+
+// Every pass: the servers and the latched output levels
+void handleClients() {
   server.handleClient();
   webSocket.loop();
+  superBeat(HB_WS);
 
   digitalWrite(LED1pin, LED1status);  
   digitalWrite(LED2pin, LED2status); 
+}
 
-  now = millis();
-  if (WiFi.status() == WL_CONNECTED) {
-    currentRSSI = WiFi.RSSI();
-  } else {
-    currentRSSI = 0;
-  }
-  
-  if (now - lastPush >= 1000 || abs(currentRSSI - lastRSSI) >= rssiThreshold) {
-    lastPush = now;
+// Once a second: temperature and uptime, plus the window stats every 10 s
+void pushTelemetry() {
+  unsigned long now = millis();
 
-    String json = "{";
-    json += "\"temp\":" + String(currentTempC, 2) + ",";
-    json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000);
-    if (WiFi.status() == WL_CONNECTED && abs(currentRSSI - lastRSSI) >= rssiThreshold) {
-      json += ",\"rssi\":" + String(currentRSSI);
-      lastRSSI = currentRSSI;
-    }
-    json += "}";
-    webSocket.broadcastTXT(json);
+  String json = "{";
+  json += "\"temp\":" + String(currentTempC, 2) + ",";
+  json += "\"uptime\":" + String(getUptimeMillis(bootMillis) / 1000);
+  if (now - lastStatsPush >= 10000) {
+    lastStatsPush = now;
+    json += ",\"stats\":" + statsJson();
+  }
+  json += "}";
+  broadcastEvent(json, TOPIC_TEMP);
+
+  // One deferred history per second, and only once there is room for it
+  for (uint8_t num = 0; historyPending && num < WEBSOCKETS_SERVER_CLIENT_MAX; ++num) {
+    if (!(historyPending & (1 << num))) continue;
+    if (!admitHistory() || !sendHistory(num)) break;
+    historyPending &= ~(1 << num);
+    admissionHistoryDeferred(true);
+    break;
   }
 }
 
-void handle_OnConnect() {
-    server.send(200, "text/html", SendHTML(LED1status, LED2status));
+void pushLogs() {
+  if (!topicsHasSubscribers(TOPIC_LOG)) return;
+
+  String lines = logsSince(logCursor);
+  if (lines.length()) topicsPublish(TOPIC_LOG, "{\"log\":\"" + jsonEscape(lines) + "\"}");
 }
   
+// Shared by the HTTP routes and the WebSocket command path
+void setLed(uint8_t num, bool on) {
+    if (num == 1) LED1status = on ? HIGH : LOW;
+    else LED2status = on ? HIGH : LOW;
+    saveStates();
+    broadcastEvent("{\"led" + String(num) + "\":" + String(on ? "true" : "false") + "}", TOPIC_GPIO);
+}
+
 void handle_led1on() {
-    LED1status = HIGH; saveStates();
     server.send(200, "application/json", "{\"led\":1,\"status\":\"on\"}");
-    webSocket.broadcastTXT("{\"led1\":true}");
+    setLed(1, true);
 }
 
 void handle_led1off() {
-    LED1status = LOW; saveStates();
     server.send(200, "application/json", "{\"led\":1,\"status\":\"off\"}");
-    webSocket.broadcastTXT("{\"led1\":false}");
+    setLed(1, false);
 }
 
 void handle_led2on() {
-    LED2status = HIGH; saveStates();
     server.send(200, "application/json", "{\"led\":2,\"status\":\"on\"}");
-    webSocket.broadcastTXT("{\"led2\":true}");
+    setLed(2, true);
 }
 
 void handle_led2off() {
-    LED2status = LOW; saveStates();
     server.send(200, "application/json", "{\"led\":2,\"status\":\"off\"}");
-    webSocket.broadcastTXT("{\"led2\":false}");
+    setLed(2, false);
 }
 
 void handle_temperature() {
@@ -171,7 +365,7 @@ void handle_temperature() {
 }
 
 void handle_NotFound() {
-  Serial.println("404 Not Found: " + server.uri());   
+  LOG_W("404 Not Found: %S", server.uri());
   server.send(404, "text/plain", "Not found");
 }
 
@@ -187,27 +381,383 @@ void handleGPIOControl() {
     server.send(200, "application/json", "{\"pin\":" + String(pin) + ",\"state\":\"" + state + "\"}");
 }
 
+/*
+Use :
+  /pwm                                         current state of all channels
+  /pwm?ch=0&pin=18&freq=5000                   assign a pin to a channel
+  /pwm?ch=0&duty=512&fade=2000                 hardware fade to 50% in 2 s
+*/
+void handlePWMControl() {
+    if (!server.hasArg("ch")) {
+        server.send(200, "application/json", pwmJson());
+        return;
+    }
+
+    long ch = server.arg("ch").toInt();
+    if (ch < 0 || ch >= PWM_CHANNELS) {
+        server.send(400, "text/plain", "Bad channel");
+        return;
+    }
+    if (server.hasArg("pin")) {
+        long pin = server.arg("pin").toInt();
+        long freq = server.hasArg("freq") ? server.arg("freq").toInt() : PWM_DEFAULT_FREQ;
+        if (!isOutputPin(pin) || freq <= 0 || !pwmConfigure(ch, pin, freq)) {
+            server.send(400, "text/plain", "Bad channel, pin or frequency");
+            return;
+        }
+    }
+
+    if (server.hasArg("duty")) {
+        long duty = server.arg("duty").toInt();
+        long fade = server.hasArg("fade") ? server.arg("fade").toInt() : 0;
+        if (duty < 0 || fade < 0 || !pwmSetDuty(ch, duty, fade)) {
+            server.send(400, "text/plain", "Bad duty or unassigned channel");
+            return;
+        }
+        broadcastEvent("{\"pwm\":{\"ch\":" + String(ch) + ",\"duty\":" + String(duty) + ",\"fade\":" + String(fade) + "}}", TOPIC_GPIO);
+    }
+
+    server.send(200, "application/json", pwmJson());
+}
+
+// The newest ?last= samples of series (all by default) as a JSON array
+static void sendSeries(const TempSeries& series) {
+    char* buf = (char*)scratchPool.take();
+    if (!buf) {
+        server.sendHeader("Retry-After", String(ADMIT_RETRY_S));
+        server.send(503, "text/plain", "Busy, try again shortly");
+        return;
+    }
+
+    uint32_t count = series.size();
+    if (server.hasArg("last")) count = min<uint32_t>(count, server.arg("last").toInt());
+
+    // Decoded straight into one pooled ~2 KB buffer at a time; the full series is never materialised
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+
+    TempSeries::Reader r = series.reader(series.size() - count);
+    server.sendContent("[", 1);
+    size_t n;
+    for (bool first = true; (n = seriesJsonChunk(r, buf + 1, POOL_SCRATCH_SIZE - 1)) > 0; first = false) {
+        buf[0] = ',';   // joins this chunk to the previous one
+        server.sendContent(first ? buf + 1 : buf, first ? n : n + 1);
+    }
+    server.sendContent("]", 1);
+    server.sendContent("");
+    scratchPool.give(buf);
+}
+
+/*
+Use :
+  /history               every retained sample, oldest first
+  /history?last=600
+*/
+void handleHistory() {
+    sendSeries(tempSeries);
+}
+
+/*
+Use :
+  /udp                                                  settings and counters
+  /udp?host=239.0.0.50&port=5140&interval=5000&enable=1
+*/
+void handleUdpExport() {
+    if (server.hasArg("host") || server.hasArg("port") || server.hasArg("interval") || server.hasArg("enable")) {
+        long port = server.hasArg("port") ? server.arg("port").toInt() : 0;
+        long interval = server.hasArg("interval") ? server.arg("interval").toInt() : 0;
+        int8_t enable = server.hasArg("enable") ? server.arg("enable") == "1" : -1;
+        if ((server.hasArg("port") && (port <= 0 || port > 65535)) || (server.hasArg("interval") && interval <= 0) ||
+            !udpConfigure(server.arg("host"), port, interval, enable)) {
+            server.send(400, "text/plain", "Bad host, port or interval");
+            return;
+        }
+    }
+    server.send(200, "application/json", udpJson());
+}
+
+/*
+Use :
+  /mqtt                                                   settings and counters
+  /mqtt?host=192.168.1.10&port=1883&base=lab/board1&enable=1
+*/
+void handleMqtt() {
+    if (server.hasArg("host") || server.hasArg("port") || server.hasArg("base") || server.hasArg("enable")) {
+        long port = server.hasArg("port") ? server.arg("port").toInt() : 0;
+        int8_t enable = server.hasArg("enable") ? server.arg("enable") == "1" : -1;
+        if ((server.hasArg("port") && (port <= 0 || port > 65535)) ||
+            !mqttConfigure(server.arg("host"), port, server.arg("base"), enable)) {
+            server.send(400, "text/plain", "Bad host (an IP address), port or base");
+            return;
+        }
+    }
+    server.send(200, "application/json", mqttJson());
+}
+
+/*
+Use :
+  /hub/peers                                  every board in view, this one first
+  /hub/peers?enable=1&interval=5000           aggregate peers, poll every 5 s
+  /hub/peers?beacon=0                         stop announcing this board
+*/
+void handleHubPeers() {
+    if (server.hasArg("enable") || server.hasArg("interval") || server.hasArg("beacon")) {
+        long interval = server.hasArg("interval") ? server.arg("interval").toInt() : 0;
+        int8_t enable = server.hasArg("enable") ? server.arg("enable") == "1" : -1;
+        int8_t beacon = server.hasArg("beacon") ? server.arg("beacon") == "1" : -1;
+        if ((server.hasArg("interval") && interval <= 0) || !hubConfigure(interval, enable, beacon)) {
+            server.send(400, "text/plain", "Bad interval");
+            return;
+        }
+    }
+    server.send(200, "application/json", hubJson());
+}
+
+// One peer's history per chunk, so the whole store is never one String
+void handleHubHistory() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    server.sendContent("{\"peers\":[", 10);
+    bool first = true;
+    for (uint8_t slot = 0; slot <= HUB_MAX_PEERS; ++slot) {
+        String part = hubHistoryJson(slot);
+        if (!part.length()) continue;
+        if (!first) server.sendContent(",", 1);
+        first = false;
+        server.sendContent(part.c_str(), part.length());
+    }
+    server.sendContent("]}", 2);
+    server.sendContent("");
+}
+
+/*
+Use :
+  /replay?start=1&rules=0&hold=0
+  /replay?stop=1
+  /replay?history=1&last=600      the replay's own series, never the live one
+*/
+void handleReplay() {
+    if (server.hasArg("history")) {
+        const TempSeries* series = replaySeries();
+        if (!series) {
+            server.send(404, "text/plain", "No replayed history, start one with &hold=1");
+            return;
+        }
+        sendSeries(*series);
+        return;
+    }
+    if (server.hasArg("start")) {
+        String error;
+        if (!replayStart(server.arg("rules") == "1", server.arg("hold") == "1", error)) {
+            server.send(409, "application/json", "{\"error\":\"" + error + "\"}");
+            return;
+        }
+    } else if (server.hasArg("stop")) {
+        replayStop();
+    }
+    server.send(200, "application/json", replayJson());
+}
+
+/*
+Use :
+  /file?path=/tempData.csv
+  curl -C - -o tempData.csv "http://192.168.1.1/file?path=/tempData.csv"     resumes with Range
+*/
+void handleFileDownload() {
+    if (!fsMounted()) {
+        server.sendHeader("Retry-After", "1");
+        server.send(503, "text/plain", "Filesystem not mounted yet");
+        return;
+    }
+    String path = server.arg("path");
+    File file = path.startsWith("/") ? APP_FS.open(path) : File();
+    if (!file || file.isDirectory()) {
+        server.send(404, "text/plain", "File not found");
+        return;
+    }
+    size_t size = file.size();
+    String etag = "\"" + String(size, HEX) + "-" + String((uint32_t)file.getLastWrite(), HEX) + "\"";
+    file.close();
+
+    String type = path.endsWith(".csv") ? "text/csv" :
+                  path.endsWith(".txt") ? "text/plain" :
+                  path.endsWith(".json") ? "application/json" : "application/octet-stream";
+
+    // Headers first, then the body goes from flash to the socket in FS_CHUNK_SIZE blocks
+    size_t offset, len;
+    if (!beginRangeResponse(server, size, type, etag, offset, len)) return;
+    WiFiClient client = server.client();
+    superHold("file");
+    streamFile(path.c_str(), client, offset, len);
+    superRelease();
+}
+
+// Between 64 KB windows of a partition download: keep WebSocket clients served
+static void serviceDuringStream() {
+    webSocket.loop();
+}
+
+/*
+Use :
+  /partition                              app partitions, ETags, transfer counters
+  /partition?bench=ota_0                  ...plus flash read speed of ota_0
+  /partition?name=ota_0                   raw image, Range and If-Range honoured
+*/
+void handlePartitionDownload() {
+    if (!server.hasArg("name")) {
+        server.send(200, "application/json", partitionsJson(server.arg("bench")));
+        return;
+    }
+    const esp_partition_t* part = findAppPartition(server.arg("name"));
+    if (!part) {
+        server.send(404, "text/plain", "Partition not found");
+        return;
+    }
+
+    server.sendHeader("Content-Disposition", "attachment; filename=\"" + String(part->label) + ".bin\"");
+    size_t offset, len;
+    if (!beginRangeResponse(server, part->size, "application/octet-stream", partitionEtag(part), offset, len)) return;
+    WiFiClient client = server.client();
+    superHold("partition");   // MBs at STA speed outlast STALL_REBOOT_MS, and job:temp can't run meanwhile
+    size_t sent = streamPartition(part, client, offset, len, serviceDuringStream);
+    superRelease();
+    if (sent < len) LOG_W("Partition %s: client left after %u of %u bytes", part->label, (unsigned)sent, (unsigned)len);
+}
+
+// "HH:MM", 00:00 to 23:59
+static bool parseTimeOfDay(const String& at, int& hour, int& minute) {
+    if (at.length() != 5 || at[2] != ':') return false;
+    for (uint8_t i : { 0, 1, 3, 4 }) {
+        if (!isDigit(at[i])) return false;
+    }
+    hour = at.substring(0, 2).toInt();
+    minute = at.substring(3).toInt();
+    return hour <= 23 && minute <= 59;
+}
+
+/*
+Use :
+  /schedule?pin=led2&action=pulse&ms=300
+  /schedule?pin=led1&action=off&at=22:00        (repeats daily)
+  /schedule?pin=gpio12&action=toggle&in=5000&every=1000
+*/
+void handleSchedule() {
+    if (!server.hasArg("pin") || !server.hasArg("action")) {
+        server.send(400, "text/plain", "Missing pin or action");
+        return;
+    }
+
+    int pin = parseOutputName(server.arg("pin").c_str());
+    String action = server.arg("action");
+    long delayMs = server.hasArg("in") ? server.arg("in").toInt() : 0;
+    long periodMs = server.hasArg("every") ? server.arg("every").toInt() : 0;
+    int id;
+
+    if (pin < 0 || delayMs < 0 || periodMs < 0) {
+        server.send(400, "text/plain", "Bad pin or timing");
+        return;
+    }
+
+    int hour = -1, minute = -1;
+    if (server.hasArg("at")) {
+        if (!parseTimeOfDay(server.arg("at"), hour, minute)) {
+            server.send(400, "text/plain", "Bad time, expected HH:MM");
+            return;
+        }
+        delayMs = msUntilTimeOfDay(hour, minute);
+        if (delayMs < 0) {
+            server.send(409, "text/plain", "Clock not synced");
+            return;
+        }
+    }
+
+    if (action == "pulse") {
+        long width = server.hasArg("ms") ? server.arg("ms").toInt() : 0;
+        if (width <= 0) {
+            server.send(400, "text/plain", "Pulse needs ms > 0");
+            return;
+        }
+        id = addPulse(pin, delayMs, width);
+    } else if (action == "on" || action == "off" || action == "toggle") {
+        uint8_t code = action == "on" ? SCHED_ACTION_ON : action == "off" ? SCHED_ACTION_OFF : SCHED_ACTION_TOGGLE;
+        // Daily ones are kept as a time of day, so a reset can't leave them firing at a stale offset
+        id = hour >= 0 ? addDailySchedule(pin, code, hour, minute) : addSchedule(pin, code, delayMs, periodMs);
+    } else {
+        server.send(400, "text/plain", "Unknown action");
+        return;
+    }
+
+    if (id < 0) {
+        server.send(503, "text/plain", "Schedule table full");
+        return;
+    }
+    server.send(200, "application/json", "{\"id\":" + String(id) + "}");
+}
+
+void handleRules() {
+    server.send(200, "application/json", rulesJson());
+}
+
+void handleRuleAdd() {
+    String error;
+    if (!server.hasArg("rule")) {
+        server.send(400, "text/plain", "Missing rule");
+        return;
+    }
+    if (!addRule(server.arg("rule"), error)) {
+        server.send(400, "text/plain", "Bad rule: " + error);
+        return;
+    }
+    server.send(200, "application/json", rulesJson());
+}
+
+void handleRuleDelete() {
+    String arg = server.arg("id");
+    char* end;
+    long id = strtol(arg.c_str(), &end, 10);
+    // Checked before the uint8_t cast, or id=256 (or id=x) would delete rule 0
+    if (arg.length() == 0 || *end || id < 0 || id > UINT8_MAX || !deleteRule(id)) {
+        server.send(404, "text/plain", "No such rule");
+        return;
+    }
+    server.send(200, "application/json", rulesJson());
+}
+
+static bool otaOk = false;     // set by the upload callback, answered by the completion handler
+
 void handleOtaUpdate() {
   prefs_ota.begin("ota", false);
 
   // === OTA Upload Handler ===
-  server.on("/update", HTTP_POST, []() {}, []() {
+  // The answer goes out from the completion handler, which is what gets
+  // timed: one /update sample per upload rather than one per buffer
+  server.on("/update", HTTP_POST, timedRoute("/update", []() {
+    if (otaOk) server.send(200, "text/plain", "Update OK");
+    else server.send(500, "text/plain", "Update Failed");
+  }), []() {
     HTTPUpload& upload = server.upload();
 
     if (upload.status == UPLOAD_FILE_START) {
-      Serial.printf("OTA Start: %s\n", upload.filename.c_str());
+      LOG_I("OTA Start: %S", upload.filename);
+      otaOk = false;
+      superHold("ota");   // the whole upload runs inside one handleClient()
       if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
         Update.printError(Serial);
       }
+      broadcastEvent("{\"ota\":{\"state\":\"start\"}}", TOPIC_OTA);
     }
     else if (upload.status == UPLOAD_FILE_WRITE) {
       if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
         Update.printError(Serial);
       }
+      if ((upload.totalSize & 0xFFFF) < upload.currentSize) {
+        broadcastEvent("{\"ota\":{\"state\":\"writing\",\"bytes\":" + String(upload.totalSize) + "}}", TOPIC_OTA);
+      }
     }
     else if (upload.status == UPLOAD_FILE_END) {
+      superRelease();
       if (Update.end(true)) {
-        Serial.println("✅ OTA Success. Rebooting soon...");
+        LOG_I("OTA Success. Rebooting soon...");
 
         const esp_partition_t* running = esp_ota_get_running_partition();
         String label = running ? String(running->label) : "unknown";
@@ -231,24 +781,31 @@ void handleOtaUpdate() {
         prefs_ota.putString("updateHistory", hist);
         prefs_ota.end();
         shouldReboot = true;
-        server.send(200, "text/plain", "Update OK");
+        otaOk = true;
+        broadcastEvent("{\"ota\":{\"state\":\"done\"}}", TOPIC_OTA);
       } else {
         Update.printError(Serial);
-        server.send(500, "text/plain", "Update Failed");
+        broadcastEvent("{\"ota\":{\"state\":\"failed\"}}", TOPIC_OTA);
       }
     }
+    else if (upload.status == UPLOAD_FILE_ABORTED) {
+      superRelease();
+      Update.abort();
+      LOG_W("OTA aborted after %u bytes", (unsigned)upload.totalSize);
+      broadcastEvent("{\"ota\":{\"state\":\"failed\"}}", TOPIC_OTA);
+    }
   });
 
   // === Serve Version Info ===
-  server.on("/ota_version", HTTP_GET, []() {
+  server.on("/ota_version", HTTP_GET, timedRoute("/ota_version", []() {
     prefs_ota.begin("ota", true);
     String version = prefs_ota.getString("lastVersion", firmwareVersion);
     prefs_ota.end();
   
     server.send(200, "text/plain", version);
-  });
+  }));
 
-  server.on("/current_version", HTTP_GET, []() {
+  server.on("/current_version", HTTP_GET, timedRoute("/current_version", []() {
     const esp_partition_t* running = esp_ota_get_running_partition();
     String label = running ? String(running->label) : "unknown";
   
@@ -262,17 +819,17 @@ void handleOtaUpdate() {
     }
   
     server.send(200, "text/plain", version);
-  });
+  }));
 
-  server.on("/ota_time", HTTP_GET, []() {
+  server.on("/ota_time", HTTP_GET, timedRoute("/ota_time", []() {
     prefs_ota.begin("ota", true);  
     String time = prefs_ota.getString("lastUpdate", "Never");
     prefs_ota.end();
     server.send(200, "text/plain", time);
-  });
+  }));
 
   // === Dropdown with all available versions ===
-  server.on("/ota_versions", HTTP_GET, []() {
+  server.on("/ota_versions", HTTP_GET, timedRoute("/ota_versions", []() {
     StaticJsonDocument<512> doc;
     JsonArray arr = doc.to<JsonArray>();
 
@@ -298,10 +855,10 @@ void handleOtaUpdate() {
     String output;
     serializeJson(doc, output);
     server.send(200, "application/json", output);
-  });
+  }));
 
   // === Switch boot partition ===
-  server.on("/switch_partition", HTTP_GET, []() {
+  server.on("/switch_partition", HTTP_GET, timedRoute("/switch_partition", []() {
     if (!server.hasArg("target")) {
       server.send(400, "text/plain", "Missing target partition");
       return;
@@ -325,26 +882,75 @@ void handleOtaUpdate() {
 
     if (esp_ota_set_boot_partition(part) == ESP_OK) {
       server.send(200, "text/plain", "✅ Boot partition set successfully.");
+      broadcastEvent("{\"ota\":{\"state\":\"switch\",\"partition\":\"" + target + "\"}}", TOPIC_OTA);
       shouldReboot = true;
     } else {
       server.send(500, "text/plain", "❌ Failed to set boot partition.");
     }
-  });
+  }));
+
+  // === Everything the OTA panel shows, in one round trip ===
+  server.on("/ota_info", HTTP_GET, timedRoute("/ota_info", []() {
+    DynamicJsonDocument doc(2048);
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    String label = running ? String(running->label) : "unknown";
+
+    prefs_ota.begin("ota", true);
+    doc["current"] = prefs_ota.getString(("version_" + label).c_str(), "Unknown");
+    doc["partition"] = label;
+    doc["last_uploaded"] = prefs_ota.getString("lastVersion", firmwareVersion);
+    doc["updated"] = prefs_ota.getString("lastUpdate", "Never");
+
+    JsonArray versions = doc.createNestedArray("versions");
+    JsonObject o0 = versions.createNestedObject();
+    o0["partition"] = "factory";
+    o0["label"] = prefs_ota.getString("version_factory", "Factory");
+    JsonObject o1 = versions.createNestedObject();
+    o1["partition"] = "ota_0";
+    o1["label"] = prefs_ota.getString("version_ota_0", "Unknown") + " (ota_0)";
+    JsonObject o2 = versions.createNestedObject();
+    o2["partition"] = "ota_1";
+    o2["label"] = prefs_ota.getString("version_ota_1", "Unknown") + " (ota_1)";
+
+    String hist = prefs_ota.getString("updateHistory", "");
+    prefs_ota.end();
+
+    JsonArray history = doc.createNestedArray("history");
+    int from = 0;
+    while (from < (int)hist.length()) {
+      int nl = hist.indexOf('\n', from);
+      if (nl < 0) nl = hist.length();
+      if (nl > from) history.add(hist.substring(from, nl));
+      from = nl + 1;
+    }
+
+    String output;
+    serializeJson(doc, output);
+    server.send(200, "application/json", output);
+  }));
 
   // === Full OTA update history list ===
-  server.on("/ota_history", HTTP_GET, []() {
+  server.on("/ota_history", HTTP_GET, timedRoute("/ota_history", []() {
     String hist = prefs_ota.getString("updateHistory", "");
     hist.trim();
     hist.replace("\n", "\",\"");
     server.send(200, "application/json", "[\"" + hist + "\"]");
-  });
+  }));
 
   prefs_ota.end();
 }
 
-/* ========== HTML Generator ========== */
-String SendHTML(uint8_t led1stat, uint8_t led2stat) {
-    String html = R"rawliteral(
+/* ========== HTML Template ========== */
+enum DashboardVar : uint8_t {
+  VAR_LED1_LAMP = 1,
+  VAR_LED1_CHECKED,
+  VAR_LED2_LAMP,
+  VAR_LED2_CHECKED,
+  VAR_FW_VERSION,
+};
+
+static const TemplateSegment dashboardPage[] = {
+  TPL_TEXT(R"rawliteral(
     <!DOCTYPE html>
     <html>
     <head>
@@ -605,18 +1211,26 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
         <div class="output-controls">
           <div class="output-control">
             <span class="label">LED</span>
-            <span class="lamp" id="led1status"></span>
+            <span class="lamp" id="led1status">)rawliteral"),
+  TPL_VAR(VAR_LED1_LAMP),
+  TPL_TEXT(R"rawliteral(</span>
             <label class="switch">
-              <input type="checkbox" id="led1toggle" onchange="toggleLED(1)">
+              <input type="checkbox" id="led1toggle" onchange="toggleLED(1)")rawliteral"),
+  TPL_VAR(VAR_LED1_CHECKED),
+  TPL_TEXT(R"rawliteral(>
               <span class="slider"></span>
             </label>
           </div>
 
           <div class="output-control">
             <span class="label">Relay 1</span>
-            <span class="lamp" id="led2status"></span>
+            <span class="lamp" id="led2status">)rawliteral"),
+  TPL_VAR(VAR_LED2_LAMP),
+  TPL_TEXT(R"rawliteral(</span>
             <label class="switch">
-              <input type="checkbox" id="led2toggle" onchange="toggleLED(2)">
+              <input type="checkbox" id="led2toggle" onchange="toggleLED(2)")rawliteral"),
+  TPL_VAR(VAR_LED2_CHECKED),
+  TPL_TEXT(R"rawliteral(>
               <span class="slider"></span>
             </label>
           </div>
@@ -660,6 +1274,9 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
           <b>📈 Max:</b> <span id="tempMax">--</span> °C &nbsp;|&nbsp;
           <b>➗ Avg:</b> <span id="tempAvg">--</span> °C
         </p>
+        <table id="statsTable" style="margin: 8px auto; border-collapse: collapse; font-size: 0.9em;">
+          <tr><th></th><th>Min</th><th>Max</th><th>Mean</th><th>Std</th></tr>
+        </table>
       </div>
 
       <div style="margin-top: 10px;">
@@ -735,13 +1352,22 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
           🌐 <a href="https://www.circuitveda.com" target="_blank">www.circuitveda.com</a>
         </p>
 
-        <p class="footer-copy">&copy; 2025 <strong>CircuitVeda</strong>. All rights reserved.</p>
+        <p class="footer-copy">&copy; 2025 <strong>CircuitVeda</strong>. All rights reserved. &nbsp;|&nbsp; Firmware )rawliteral"),
+  TPL_VAR(VAR_FW_VERSION),
+  TPL_TEXT(R"rawliteral(</p>
       </footer>
 
       <script>
         let lastClients = -1;
         let lastSTAIP = '';
-        let ws = new WebSocket('ws://' + location.hostname + ':81/');
+        // Large frames (history, status) arrive as raw-deflate binary when the browser can inflate them.
+        // Some browsers have DecompressionStream but only for 'gzip'/'deflate'; the constructor throws then.
+        function canInflateRaw() {
+          try { new DecompressionStream('deflate-raw'); return true; } catch (e) { return false; }
+        }
+        let ws = new WebSocket('ws://' + location.hostname + ':81/?topics=temp,rssi,gpio,ota' +
+                               (window.DecompressionStream && canInflateRaw() ? '&deflate=1' : ''));
+        ws.binaryType = 'arraybuffer';
         let tempData = [], timeLabels = [], seconds = 0, sessionSeconds = 0;
         let chart, autoScale = true;
         let countdown = 10;
@@ -772,14 +1398,45 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
           }
         }
 
+        let events = null;
+
         ws.onopen = () => {
           sessionSeconds = 0;  
           ws.send('getStatus');
         };
 
-        ws.onmessage = evt => {
+        // Port 81 is often blocked by proxies; fall back to the SSE stream
+        // on port 80, which carries the same frames.
+        ws.onerror = () => {
+          if (ws.readyState !== WebSocket.OPEN && !events) {
+            events = new EventSource('/events');
+            events.onmessage = handleUpdate;
+          }
+        };
+
+        function requestStatus() {
+          if (ws.readyState === WebSocket.OPEN) ws.send('getStatus');
+        }
+
+        // Inflating is async; the chain keeps frames in arrival order
+        let rx = Promise.resolve();
+        ws.onmessage = (evt) => {
+          rx = rx.then(() => {
+            if (!(evt.data instanceof ArrayBuffer)) return evt.data;
+            const inflated = new Blob([evt.data]).stream().pipeThrough(new DecompressionStream('deflate-raw'));
+            return new Response(inflated).text();
+          }).then(text => handleUpdate({ data: text }), err => console.error(err));
+        };
+
+        function handleUpdate(evt) {
           let d = JSON.parse(evt.data);
 
+          // Turned away by admission control; come back when told to
+          if (d.busy) {
+            setTimeout(() => location.reload(), (d.retry_after || 5) * 1000);
+            return;
+          }
+
           if (d.led1 !== undefined) {
             document.getElementById('led1status').innerHTML = d.led1
               ? "<span class='lamp on'></span>"
@@ -846,6 +1503,20 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
             document.getElementById('clients').innerText = d.clients;
           }
 
+          if (d.stats !== undefined) {
+            const table = document.getElementById('statsTable');
+            const labels = { '1m': '1 min', '10m': '10 min', '1h': '1 h', 'boot': 'Since boot' };
+            table.querySelectorAll('tr.stat').forEach(r => r.remove());
+            Object.keys(labels).forEach(k => {
+              const w = d.stats[k];
+              if (!w || w.n === 0) return;
+              const row = table.insertRow();
+              row.className = 'stat';
+              [labels[k], w.min.toFixed(2), w.max.toFixed(2), w.mean.toFixed(2), w.std.toFixed(3)]
+                .forEach(v => { row.insertCell().innerText = v; });
+            });
+          }
+
           if (d.history !== undefined) {
             d.history.forEach(point => {
               tempData.push(point.temp);
@@ -861,7 +1532,7 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
               updateTempStats();
             }
           }
-        };
+        }
 
         window.onload = () => {
           const ctx = document.getElementById('tempChart').getContext('2d');
@@ -925,7 +1596,9 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
           } else if (num === 2) {
             path = isOn ? '/led2on' : '/led2off';
           }
-          fetch(path).then(() => ws.send('getStatus'));
+          // The open socket saves a TCP handshake per toggle; the broadcast updates every view
+          if (ws.readyState === WebSocket.OPEN) ws.send(path.substring(1));
+          else fetch(path);
         }
 
         function sendGPIO() {
@@ -1062,39 +1735,32 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
 
         async function loadOtaInfo() {
           try {
-            const version = await fetch('/current_version').then(r => r.text());
-            const lastUploaded = await fetch('/ota_version').then(r => r.text());
-            const updated = await fetch('/ota_time').then(r => r.text());
-            const history = await fetch('/ota_history').then(r => r.json());
+            const info = await fetch('/ota_info').then(r => r.json());
 
-            document.getElementById("currentVersion").innerText = version;
-            document.getElementById("lastUploadedVersion").innerText = lastUploaded;
-            document.getElementById("lastUpdate").innerText = updated;
+            document.getElementById("currentVersion").innerText = info.current;
+            document.getElementById("lastUploadedVersion").innerText = info.last_uploaded;
+            document.getElementById("lastUpdate").innerText = info.updated;
 
             const list = document.getElementById("otaHistoryList");
             list.innerHTML = "";
-            history.forEach(entry => {
+            info.history.forEach(entry => {
               const li = document.createElement("li");
               li.textContent = entry;
               list.appendChild(li);
             });
+
+            const dropdown = document.getElementById('versionSelector');
+            dropdown.innerHTML = '';
+            info.versions.forEach(v => {
+              const opt = document.createElement('option');
+              opt.value = v.partition;
+              opt.text = v.label;
+              dropdown.appendChild(opt);
+            });
           } catch (err) {
             console.error("Error loading OTA info:", err);
           }
         }
-        
-        async function loadVersionsDropdown() {
-          const versions = await fetch('/ota_versions').then(r => r.json());
-          const dropdown = document.getElementById('versionSelector');
-          dropdown.innerHTML = '';
-
-          versions.forEach(v => {
-            const opt = document.createElement('option');
-            opt.value = v.partition;
-            opt.text = v.label;
-            dropdown.appendChild(opt);
-          });
-        }
 
         async function switchFirmware() {
           const firmwareInput = document.getElementById("firmwareFile");
@@ -1145,11 +1811,205 @@ String SendHTML(uint8_t led1stat, uint8_t led2stat) {
         }
 
         window.addEventListener('load', loadOtaInfo);
-        window.addEventListener("load", loadVersionsDropdown);
       </script>
     </body>
     </html>
-    )rawliteral";
-    return html;
+)rawliteral"),
+};
+
+struct DashboardState {
+  uint8_t led1;
+  uint8_t led2;
+};
+
+static size_t resolveDashboard(uint8_t var, char* out, size_t cap, void* ctx) {
+  const DashboardState* st = (const DashboardState*)ctx;
+  switch (var) {
+    case VAR_LED1_LAMP:    return snprintf(out, cap, "<span class='lamp %s'></span>", st->led1 ? "on" : "off");
+    case VAR_LED2_LAMP:    return snprintf(out, cap, "<span class='lamp %s'></span>", st->led2 ? "on" : "off");
+    case VAR_LED1_CHECKED: return snprintf(out, cap, "%s", st->led1 ? " checked" : "");
+    case VAR_LED2_CHECKED: return snprintf(out, cap, "%s", st->led2 ? " checked" : "");
+    case VAR_FW_VERSION:   return snprintf(out, cap, "%s", FW_VERSION);
   }
-  
\ No newline at end of file
+  return 0;
+}
+
+/* ========== HTML Generator ========== */
+String SendHTML(uint8_t led1stat, uint8_t led2stat) {
+    DashboardState st = { led1stat, led2stat };
+    return renderTemplate(TPL_SEGMENTS(dashboardPage), resolveDashboard, &st);
+  }
+  
+
+// [0] streamed template, [1] legacy single String, for side-by-side numbers
+static struct {
+    uint32_t count;
+    uint32_t firstByteUs;
+    uint32_t totalUs;
+    uint32_t heapUsed;
+} pageStats[2];
+
+/*
+Use :
+  /               dashboard, streamed from the segment table
+  /?legacy=1      same page rendered into one String first
+*/
+void handle_OnConnect() {
+    uint32_t freeBefore = ESP.getFreeHeap();
+    TemplateStats st;
+    bool legacy = server.hasArg("legacy");
+
+    if (legacy) {
+        uint32_t start = micros();
+        String html = SendHTML(LED1status, LED2status);
+        st.minFreeHeap = ESP.getFreeHeap();
+        st.firstByteUs = micros() - start;
+        server.send(200, "text/html", html);
+        st.totalUs = micros() - start;
+    } else {
+        DashboardState state = { LED1status, LED2status };
+        streamTemplate(server, "text/html", TPL_SEGMENTS(dashboardPage), resolveDashboard, &state, &st);
+    }
+
+    auto& p = pageStats[legacy ? 1 : 0];
+    p.count++;
+    p.firstByteUs = st.firstByteUs;
+    p.totalUs = st.totalUs;
+    p.heapUsed = freeBefore > st.minFreeHeap ? freeBefore - st.minFreeHeap : 0;
+}
+
+String pageStatsJson() {
+    String json = "{";
+    for (uint8_t i = 0; i < 2; ++i) {
+        if (i > 0) json += ",";
+        json += String(i == 0 ? "\"streamed\"" : "\"legacy\"") + ":{";
+        json += "\"count\":" + String(pageStats[i].count) + ",";
+        json += "\"ttfb_us\":" + String(pageStats[i].firstByteUs) + ",";
+        json += "\"total_us\":" + String(pageStats[i].totalUs) + ",";
+        json += "\"heap_used\":" + String(pageStats[i].heapUsed) + "}";
+    }
+    json += "}";
+    return json;
+}
+
+/* ========== Hub Page ========== */
+
+// Static: history comes from /hub/history once, then the hub WebSocket topic
+static const char hubPage[] PROGMEM = R"rawliteral(<!DOCTYPE html>
+<html>
+<head>
+  <meta charset='UTF-8'>
+  <meta name='viewport' content='width=device-width, initial-scale=1.0'>
+  <title>Mingle Hub</title>
+  <style>
+    body { font-family: Arial, sans-serif; margin: 0; padding: 20px; background: #f7f7f7; text-align: center; }
+    table { margin: 0 auto; border-collapse: collapse; background: #fff; box-shadow: 0 1px 4px rgba(0,0,0,.1); }
+    th, td { padding: 6px 12px; border-bottom: 1px solid #eee; }
+    th { background: #2196F3; color: #fff; font-weight: normal; }
+    tr.stale td { color: #aaa; }
+    .lamp { display: inline-block; width: 10px; height: 10px; border-radius: 50%; background: #ccc; }
+    .lamp.on { background: #4caf50; }
+    svg { width: 180px; height: 32px; }
+    a { color: #2196F3; }
+  </style>
+</head>
+<body>
+  <h2>Mingle Hub</h2>
+  <p id='summary'>--</p>
+  <table>
+    <thead><tr><th>Board</th><th>IP</th><th>Temp (&deg;C)</th><th>History</th><th>RSSI</th>
+      <th>Clients</th><th>LEDs</th><th>Uptime</th><th>Heap</th></tr></thead>
+    <tbody id='peers'></tbody>
+  </table>
+  <p><a href='/'>This board's dashboard</a></p>
+  <script>
+    const HISTORY = 120;
+    const history = {};
+
+    function spark(points) {
+      const vals = points.filter(v => v !== null);
+      if (vals.length < 2) return '';
+      const lo = Math.min(...vals), hi = Math.max(...vals), span = (hi - lo) || 1;
+      let d = '', pen = 'M';
+      points.forEach((v, i) => {
+        if (v === null) { pen = 'M'; return; }
+        d += pen + (i * 180 / (HISTORY - 1)).toFixed(1) + ',' + (30 - (v - lo) * 28 / span).toFixed(1) + ' ';
+        pen = 'L';
+      });
+      return "<svg viewBox='0 0 180 32'><path d='" + d + "' fill='none' stroke='#2196F3' stroke-width='1.5'/></svg>";
+    }
+
+    function uptime(s) {
+      const h = Math.floor(s / 3600), m = Math.floor((s % 3600) / 60);
+      return h + 'h ' + String(m).padStart(2, '0') + 'm';
+    }
+
+    function cell(tr, text) {
+      const td = tr.insertCell();
+      td.textContent = text;
+      return td;
+    }
+
+    // Names come from unauthenticated beacons: text only, never markup
+    function render(peers) {
+      document.getElementById('summary').innerText = peers.length + ' board' + (peers.length === 1 ? '' : 's');
+      const body = document.getElementById('peers');
+      body.replaceChildren();
+      peers.forEach(p => {
+        const tr = body.insertRow();
+        if (!p.fresh) tr.className = 'stale';
+        const a = document.createElement('a');
+        a.href = 'http://' + p.ip + '/';
+        a.textContent = p.name;
+        tr.insertCell().appendChild(a);
+        cell(tr, p.ip);
+        cell(tr, p.temp === null ? '--' : p.temp.toFixed(2));
+        tr.insertCell().innerHTML = spark(history[p.id] || []);   // numbers only
+        cell(tr, p.rssi);
+        cell(tr, p.clients);
+        const leds = tr.insertCell();
+        [p.led1, p.led2].forEach(on => {
+          const lamp = document.createElement('span');
+          lamp.className = 'lamp' + (on ? ' on' : '');
+          leds.append(lamp, ' ');
+        });
+        cell(tr, uptime(p.uptime));
+        cell(tr, Math.round(p.heap / 1024) + ' KB');
+      });
+    }
+
+    function onRound(hub) {
+      hub.peers.forEach(p => {
+        const h = history[p.id] || (history[p.id] = []);
+        h.push(p.fresh ? p.temp : null);
+        if (h.length > HISTORY) h.shift();
+      });
+      render(hub.peers);
+    }
+
+    function connect() {
+      const ws = new WebSocket('ws://' + location.hostname + ':81/?topics=hub&history=0');
+      ws.onmessage = e => {
+        const d = JSON.parse(e.data);
+        if (d.busy) { ws.onclose = null; setTimeout(connect, (d.retry_after || 5) * 1000); return; }
+        if (d.hub) onRound(d.hub);
+      };
+      ws.onclose = () => setTimeout(connect, 3000);
+    }
+
+    fetch('/hub/history').then(r => r.json()).then(d => {
+      d.peers.forEach(p => history[p.id] = p.history);
+      return fetch('/hub/peers');
+    }).then(r => r.json()).then(d => {
+      if (!d.enabled) document.getElementById('summary').innerText = 'Hub mode is off: /hub/peers?enable=1';
+      else render(d.peers);
+      connect();
+    });
+  </script>
+</body>
+</html>
+)rawliteral";
+
+void handleHubPage() {
+    server.send_P(200, "text/html", hubPage);
+}
\ No newline at end of file
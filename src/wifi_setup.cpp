@@ -2,6 +2,9 @@
 #include "wifi_setup.h"
 #include <ESPmDNS.h>
 #include <utilities.h>
+#include "boot_profile.h"
+#include "logger.h"
+#include "link_monitor.h"
 
 const char* ssid = "SmartHome";     // AP
 const char* password = "12345678";
@@ -19,104 +22,58 @@ int reconnectAttempts = 0;
 const int maxReconnectAttempts = 5;
 long rssi;
 bool mdnsStarted = false;
+static bool staBootMarked = false;
 
 void initWiFi() {
-  unsigned long startAttemptTime;
-  bool success;
-
   WiFi.mode(WIFI_AP_STA);
 
   WiFi.softAPConfig(local_ip, gateway, subnet);
   WiFi.setHostname(DEVICE_NAME);
   WiFi.softAP(ssid, password);
-  Serial.println("[AP] SoftAP started");
-  Serial.print("[AP] IP address: ");
-  Serial.println(WiFi.softAPIP());
-
-  Serial.println();
-  Serial.println("======= Connect to ESP32 AP =======");
-  Serial.print("SSID:     "); Serial.println(ssid);
-  Serial.print("Password: "); Serial.println(password);
-  Serial.println("===================================");
+  LOG_I("[AP] SoftAP started");
+  LOG_I("[AP] IP address: %I", WiFi.softAPIP());
+  LOG_I("[AP] SSID: %s  Password: %s", ssid, password);
   
   if (MDNS.begin(DEVICE_NAME)) {
-    Serial.println();
-    Serial.println("🚀 Smart Dashboard started successfully!");
-    Serial.println("📡 To access the dashboard, open your browser and enter:");
-    Serial.println("[AP] 👉 http://" + String(DEVICE_NAME) + ".local");
-    Serial.println("💡 Make sure you're connected to the " + String(ssid) + " Wi-Fi network.");
-    Serial.println("🔁 If the above doesn't work, try: http://" + WiFi.softAPIP().toString());
-    Serial.println();
+    LOG_I("[AP] Dashboard: http://%s.local or http://%I on the %s network", DEVICE_NAME, WiFi.softAPIP(), ssid);
   }
 
-  Serial.print("[STA] Connecting to WiFi: ");
-  Serial.println(sta_ssid);
+  LOG_I("[STA] Connecting to WiFi: %s", sta_ssid);
   WiFi.setHostname(DEVICE_NAME);
   WiFi.begin(sta_ssid, sta_password);
 
-  startAttemptTime = millis();
-  success = false;
-  while (millis() - startAttemptTime < 10000) { 
-    if (WiFi.status() == WL_CONNECTED) {
-      success = true;
-      break;
-    }
-    delay(500);
-    Serial.print(".");
-  }
-
-  if (success) {
-    Serial.println("\n[STA] Connected!");
-    Serial.print("[STA] IP address: ");
-    Serial.println(WiFi.localIP());
-    staConnected = true;
-
-    if (!mdnsStarted && MDNS.begin(DEVICE_NAME)) {
-      mdnsStarted = true;
-      Serial.println();
-      Serial.println("🚀 Smart Dashboard started successfully for the " + String(sta_ssid) + " network!");
-      Serial.println("📡 To access the dashboard, open your browser and enter:");
-      Serial.println("[STA] 👉 http://" + String(DEVICE_NAME) + ".local");
-      Serial.println("💡 Make sure your PC or phone is connected to the " + String(sta_ssid) + " Wi-Fi network.");
-      Serial.println("🔁 If the above doesn't work, try: http://" + WiFi.localIP().toString());
-      Serial.println();
-    }
-  } else {
-    Serial.println("\n[STA] Failed to connect");
-    Serial.print("[STA] Status code: ");
-    Serial.println(WiFi.status());
-    staConnected = false;
-  }
-
-  rssi = WiFi.RSSI();
-  Serial.println("[STA] RSSI: " + String(WiFi.RSSI()) + " dBm");
+  // Don't wait for the router here: the AP side is already serving and
+  // maintainWiFi() announces the STA link once it comes up.
+  staConnected = false;
+  reconnectAttempts = 1;
+  lastReconnectAttempt = millis();
 }
 
 void maintainWiFi() {
-  if (WiFi.status() == WL_CONNECTED) {
+  if (linkStaUp()) {
     if (!staConnected) {
-      Serial.println("[STA] Reconnected!");
-      Serial.print("[STA] IP address: ");
-      Serial.println(WiFi.localIP());
+      LOG_I("[STA] Connected, IP address: %I", WiFi.localIP());
       staConnected = true;
       reconnectAttempts = 0;
+      rssi = WiFi.RSSI();
+      LOG_I("[STA] RSSI: %ld dBm", rssi);
+
+      if (!staBootMarked) {
+        staBootMarked = true;
+        bootMark("sta");
+        configTzTime(TIME_ZONE, NTP_SERVER);   // wall clock for timed schedules
+      }
 
       if (!mdnsStarted && MDNS.begin(DEVICE_NAME)) {
         mdnsStarted = true;
-        Serial.println();
-        Serial.println("🚀 Smart Dashboard started successfully for the " + String(sta_ssid) + " network!");
-        Serial.println("📡 To access the dashboard, open your browser and enter:");
-        Serial.println("[STA] 👉 http://" + String(DEVICE_NAME) + ".local");
-        Serial.println("💡 Make sure your PC or phone is connected to the " + String(sta_ssid) + " Wi-Fi network.");
-        Serial.println("🔁 If the above doesn't work, try: http://" + WiFi.localIP().toString());
-        Serial.println();
+        LOG_I("[STA] Dashboard: http://%s.local or http://%I on the %s network", DEVICE_NAME, WiFi.localIP(), sta_ssid);
       }
     }
     return;
   }
 
   if (staConnected) {
-    Serial.println("[STA] Lost connection!");
+    LOG_W("[STA] Lost connection!");
     staConnected = false;
     reconnectAttempts = 1;
     lastReconnectAttempt = millis();
@@ -125,14 +82,15 @@ void maintainWiFi() {
   if (!staConnected && reconnectAttempts > 0 && reconnectAttempts <= maxReconnectAttempts) {
     unsigned long now = millis();
     if (now - lastReconnectAttempt >= reconnectInterval) {
-      Serial.printf("[STA] Reconnect attempt %d/%d...\n", reconnectAttempts, maxReconnectAttempts);
+      LOG_I("[STA] Reconnect attempt %d/%d...", reconnectAttempts, maxReconnectAttempts);
       WiFi.disconnect();
       WiFi.begin(sta_ssid, sta_password);
       lastReconnectAttempt = now;
       reconnectAttempts++;
     }
-  } else if (reconnectAttempts > maxReconnectAttempts) {
-    Serial.println("[STA] Max reconnect attempts reached. Giving up.");
-    Serial.println("[STA] Restart the device for re-connecting.");
+  } else if (reconnectAttempts == maxReconnectAttempts + 1) {
+    // Logged once; this branch used to fire on every loop() pass
+    LOG_W("[STA] Max reconnect attempts reached. Giving up, restart the device to reconnect.");
+    reconnectAttempts++;
   }
 }
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include "ws_deflate.h"
+#include "mem_pool.h"
+
+static const uint16_t lengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+struct BitWriter {
+  uint8_t* out;
+  size_t cap;
+  size_t pos;
+  uint32_t acc;
+  uint8_t nbits;
+  bool overflow;
+
+  // DEFLATE packs fields LSB first
+  void put(uint32_t value, uint8_t n) {
+    acc |= value << nbits;
+    nbits += n;
+    while (nbits >= 8) {
+      if (pos < cap) out[pos++] = acc & 0xFF;
+      else overflow = true;
+      acc >>= 8;
+      nbits -= 8;
+    }
+  }
+
+  // ...but Huffman codes MSB first
+  void putCode(uint32_t code, uint8_t n) {
+    uint32_t rev = 0;
+    for (uint8_t i = 0; i < n; ++i) rev |= ((code >> i) & 1) << (n - 1 - i);
+    put(rev, n);
+  }
+
+  void flush() {
+    if (nbits > 0) put(0, 8 - nbits);
+  }
+};
+
+// Fixed literal/length code from RFC 1951 3.2.6
+static void putLitLen(BitWriter& w, uint16_t sym) {
+  if (sym < 144)      w.putCode(0x30 + sym, 8);
+  else if (sym < 256) w.putCode(0x190 + sym - 144, 9);
+  else if (sym < 280) w.putCode(sym - 256, 7);
+  else                w.putCode(0xC0 + sym - 280, 8);
+}
+
+static void putMatch(BitWriter& w, uint16_t len, uint16_t dist) {
+  uint8_t li = 28;
+  while (lengthBase[li] > len) li--;
+  putLitLen(w, 257 + li);
+  if (lengthExtra[li]) w.put(len - lengthBase[li], lengthExtra[li]);
+
+  uint8_t di = 29;
+  while (distBase[di] > dist) di--;
+  w.putCode(di, 5);
+  if (distExtra[di]) w.put(dist - distBase[di], distExtra[di]);
+}
+
+static inline uint16_t hash3(const uint8_t* p) {
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (uint32_t)(v * 2654435761u) >> (32 - WS_DEFLATE_HASH_BITS);
+}
+
+size_t deflateRaw(const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+  // Positions are 16-bit to keep the table small; 0xFFFF marks an empty slot
+  if (len >= 0xFFFF) return 0;
+  uint16_t* head = (uint16_t*)scratchPool.take();
+  if (!head) return 0;
+  memset(head, 0xFF, sizeof(uint16_t) << WS_DEFLATE_HASH_BITS);
+
+  BitWriter w = { out, cap, 0, 0, 0, false };
+  w.put(1, 1);   // BFINAL
+  w.put(1, 2);   // BTYPE = fixed Huffman
+
+  size_t i = 0;
+  while (i < len && !w.overflow) {
+    uint16_t best = 0;
+    uint32_t dist = 0;
+
+    if (i + 3 <= len) {
+      uint16_t h = hash3(in + i);
+      uint32_t cand = head[h];
+      head[h] = i;
+      if (cand != 0xFFFF && i - cand <= WS_DEFLATE_MAX_DIST) {
+        size_t maxLen = min<size_t>(258, len - i);
+        uint16_t n = 0;
+        while (n < maxLen && in[cand + n] == in[i + n]) n++;
+        if (n >= 3) {
+          best = n;
+          dist = i - cand;
+        }
+      }
+    }
+
+    if (best) {
+      putMatch(w, best, dist);
+      // Index the skipped positions so later matches can land inside this one
+      for (size_t k = i + 1; k < i + best && k + 3 <= len; ++k) head[hash3(in + k)] = k;
+      i += best;
+    } else {
+      putLitLen(w, in[i]);
+      i++;
+    }
+  }
+
+  putLitLen(w, 256);
+  w.flush();
+  scratchPool.give(head);
+  return (w.overflow || w.pos >= cap) ? 0 : w.pos;
+}
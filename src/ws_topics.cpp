@@ -0,0 +1,288 @@
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+#include "ws_topics.h"
+#include "metrics.h"
+#include "ws_deflate.h"
+#include "mem_pool.h"
+
+static_assert(WEBSOCKETS_SERVER_CLIENT_MAX <= 8, "subscriber masks are one byte");
+
+extern WebSocketsServer webSocket;
+
+static const char* const topicNames[TOPIC_COUNT] = { "temp", "rssi", "gpio", "ota", "log", "hub" };
+
+struct TopicCounters {
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t bytesSaved;   // what a send-to-everyone broadcast would have cost on top
+};
+
+static uint8_t connectedMask;
+static uint8_t noHistoryMask;
+static uint8_t topicSubs[TOPIC_COUNT];
+static uint16_t topicRate[WEBSOCKETS_SERVER_CLIENT_MAX][TOPIC_COUNT];
+static uint32_t topicLastSent[WEBSOCKETS_SERVER_CLIENT_MAX][TOPIC_COUNT];
+static TopicCounters counters[TOPIC_COUNT];
+
+struct DeflateSession {
+  uint32_t frames;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+};
+
+static uint8_t deflateMask;
+static DeflateSession deflateSessions[WEBSOCKETS_SERVER_CLIENT_MAX];
+static uint32_t deflateCpuUs;
+static uint32_t deflateScratchPeak;
+
+static int8_t topicByName(const char* name, size_t len) {
+  for (uint8_t t = 0; t < TOPIC_COUNT; ++t) {
+    if (strlen(topicNames[t]) == len && strncmp(topicNames[t], name, len) == 0) return t;
+  }
+  return -1;
+}
+
+// "temp:5000,gpio" -> set or clear each named topic, with an optional
+// minimum interval in ms. Parsing stops at '&' or the end of the string.
+static void applyTopicList(uint8_t num, const char* list, bool subscribe) {
+  const char* p = list;
+  while (*p && *p != '&') {
+    const char* end = p;
+    while (*end && *end != ',' && *end != ':' && *end != '&') end++;
+    int8_t topic = topicByName(p, end - p);
+
+    uint32_t rate = 0;
+    if (*end == ':') {
+      char* after;
+      rate = strtoul(end + 1, &after, 10);
+      end = after;
+    }
+
+    if (topic >= 0) {
+      if (subscribe) {
+        topicSubs[topic] |= 1 << num;
+        topicRate[num][topic] = rate > 0xFFFF ? 0xFFFF : rate;
+      } else {
+        topicSubs[topic] &= ~(1 << num);
+      }
+    }
+
+    while (*end && *end != ',' && *end != '&') end++;
+    p = (*end == ',') ? end + 1 : end;
+  }
+}
+
+void topicsConnected(uint8_t num, const char* url) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) return;
+  connectedMask |= 1 << num;
+  noHistoryMask &= ~(1 << num);
+  memset(topicLastSent[num], 0, sizeof(topicLastSent[num]));
+
+  const char* topics = strstr(url, "topics=");
+  for (uint8_t t = 0; t < TOPIC_COUNT; ++t) {
+    if (!topics && (TOPIC_LEGACY_MASK & (1 << t))) topicSubs[t] |= 1 << num;
+    else topicSubs[t] &= ~(1 << num);
+    topicRate[num][t] = 0;
+  }
+  if (topics) applyTopicList(num, topics + 7, true);
+
+  if (strstr(url, "history=0")) noHistoryMask |= 1 << num;
+
+  // The WebSockets library cannot negotiate permessage-deflate, so the
+  // client opts in here and inflates binary frames itself.
+  deflateMask &= ~(1 << num);
+  if (strstr(url, "deflate=1")) deflateMask |= 1 << num;
+  deflateSessions[num] = DeflateSession();
+}
+
+void topicsDisconnected(uint8_t num) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) return;
+  connectedMask &= ~(1 << num);
+  for (uint8_t t = 0; t < TOPIC_COUNT; ++t) topicSubs[t] &= ~(1 << num);
+}
+
+bool topicsHandleMessage(uint8_t num, const String& msg) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) return false;
+  if (msg.startsWith("sub ")) {
+    applyTopicList(num, msg.c_str() + 4, true);
+    return true;
+  }
+  if (msg.startsWith("unsub ")) {
+    applyTopicList(num, msg.c_str() + 6, false);
+    return true;
+  }
+  return false;
+}
+
+bool topicsWantsHistory(uint8_t num) {
+  return num >= WEBSOCKETS_SERVER_CLIENT_MAX || !(noHistoryMask & (1 << num));
+}
+
+bool topicsHasSubscribers(WsTopic topic) {
+  return topicSubs[topic] != 0;
+}
+
+// A frame on its way out. Copies live in pooled blocks with
+// WS_FRAME_HEADROOM spare bytes in front: handed over with
+// headerToPayload, the library writes its header into the gap instead of
+// malloc'ing header + payload for every frame under 1400 bytes.
+struct OutFrame {
+  const char* src;
+  size_t len;
+  uint8_t* text;        // pooled copy of src, when it fits
+  uint8_t* packed;      // pooled raw-deflate copy, when it shrank
+  size_t packedLen;
+  bool ownsText;
+  bool textTried;
+  bool packTried;
+};
+
+static void frameFrom(OutFrame& f, const char* src, size_t len) {
+  f = OutFrame();
+  f.src = src;
+  f.len = len;
+}
+
+static void frameRelease(OutFrame& f) {
+  if (f.ownsText) framePool.give(f.text);
+  framePool.give(f.packed);
+}
+
+static void framePack(OutFrame& f) {
+  if (f.packTried) return;
+  f.packTried = true;
+
+  uint32_t start = micros();
+  f.packed = (uint8_t*)framePool.take();
+  size_t cap = min<size_t>(f.len, WS_FRAME_PAYLOAD);
+  f.packedLen = f.packed ? deflateRaw((const uint8_t*)f.src, f.len, f.packed + WS_FRAME_HEADROOM, cap) : 0;
+  deflateCpuUs += micros() - start;
+  deflateScratchPeak = max<uint32_t>(deflateScratchPeak, cap + (sizeof(uint16_t) << WS_DEFLATE_HASH_BITS));
+
+  if (f.packedLen == 0) {
+    framePool.give(f.packed);
+    f.packed = nullptr;
+  }
+}
+
+static bool wantsDeflate(uint8_t num, size_t len) {
+  return (deflateMask & (1 << num)) && len >= WS_DEFLATE_MIN_SIZE;
+}
+
+// Returns the bytes put on the wire, 0 if the send failed
+static size_t frameSend(uint8_t num, OutFrame& f) {
+  if (num < WEBSOCKETS_SERVER_CLIENT_MAX && wantsDeflate(num, f.len)) {
+    framePack(f);
+    if (f.packed) {
+      DeflateSession& s = deflateSessions[num];
+      s.frames++;
+      s.bytesIn += f.len;
+      s.bytesOut += f.packedLen;
+      return webSocket.sendBIN(num, f.packed, f.packedLen, true) ? f.packedLen : 0;
+    }
+  }
+
+  if (!f.textTried) {
+    f.textTried = true;
+    f.text = f.len <= WS_FRAME_PAYLOAD ? (uint8_t*)framePool.take() : nullptr;
+    if (f.text) {
+      memcpy(f.text + WS_FRAME_HEADROOM, f.src, f.len);
+      f.ownsText = true;
+    }
+  }
+  // Larger frames go out header-first straight from src, which needs no copy
+  bool ok = f.text ? webSocket.sendTXT(num, f.text, f.len, true) : webSocket.sendTXT(num, f.src, f.len);
+  return ok ? f.len : 0;
+}
+
+// One client, e.g. a status reply
+bool wsSend(uint8_t num, const String& json) {
+  OutFrame f;
+  frameFrom(f, json.c_str(), json.length());
+  bool ok = frameSend(num, f) > 0;
+  frameRelease(f);
+  return ok;
+}
+
+// frame is a framePool block the caller filled at WS_FRAME_HEADROOM and still owns
+bool wsSendPooled(uint8_t num, uint8_t* frame, size_t len) {
+  OutFrame f;
+  frameFrom(f, (const char*)frame + WS_FRAME_HEADROOM, len);
+  f.text = frame;
+  f.textTried = true;
+  bool ok = frameSend(num, f) > 0;
+  frameRelease(f);
+  return ok;
+}
+
+// The frame is serialized once by the caller, copied and compressed at
+// most once, whatever the number of subscribers; each one only costs a send
+void topicsPublish(WsTopic topic, const String& json) {
+  uint32_t now = millis();
+  size_t len = json.length();
+  TopicCounters& c = counters[topic];
+  OutFrame f;
+  frameFrom(f, json.c_str(), len);
+
+  for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; ++num) {
+    uint8_t bit = 1 << num;
+    if (!(connectedMask & bit)) continue;
+
+    uint16_t rate = topicRate[num][topic];
+    if (!(topicSubs[topic] & bit) || (rate && now - topicLastSent[num][topic] < rate)) {
+      c.bytesSaved += len;
+      continue;
+    }
+
+    topicLastSent[num][topic] = now;
+    size_t sent = frameSend(num, f);
+    if (sent) {
+      c.frames++;
+      c.bytes += sent;
+    } else {
+      metricsFrameDropped();
+    }
+  }
+  frameRelease(f);
+}
+
+uint8_t topicsClientCount() {
+  uint8_t n = 0;
+  for (uint8_t m = connectedMask; m; m >>= 1) n += m & 1;
+  return n;
+}
+
+String topicsJson() {
+  String json = "{";
+  for (uint8_t t = 0; t < TOPIC_COUNT; ++t) {
+    uint8_t subs = topicSubs[t];
+    uint8_t n = 0;
+    while (subs) { n += subs & 1; subs >>= 1; }
+
+    if (t > 0) json += ",";
+    json += "\"" + String(topicNames[t]) + "\":{";
+    json += "\"subscribers\":" + String(n) + ",";
+    json += "\"frames\":" + String(counters[t].frames) + ",";
+    json += "\"bytes\":" + String(counters[t].bytes) + ",";
+    json += "\"bytes_saved\":" + String(counters[t].bytesSaved) + "}";
+  }
+
+  uint32_t in = 0, out = 0;
+  String sessions;
+  for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; ++num) {
+    if (!(connectedMask & deflateMask & (1 << num))) continue;
+    const DeflateSession& s = deflateSessions[num];
+    in += s.bytesIn;
+    out += s.bytesOut;
+    if (sessions.length()) sessions += ",";
+    sessions += "{\"client\":" + String(num) + ",\"frames\":" + String(s.frames) +
+                ",\"bytes_in\":" + String(s.bytesIn) + ",\"bytes_out\":" + String(s.bytesOut) + "}";
+  }
+  json += ",\"deflate\":{";
+  json += "\"ratio\":" + String(out ? (float)in / out : 0.0f, 2) + ",";
+  json += "\"cpu_us\":" + String(deflateCpuUs) + ",";
+  json += "\"scratch_peak\":" + String(deflateScratchPeak) + ",";
+  json += "\"sessions\":[" + sessions + "]}";
+  json += "}";
+  return json;
+}
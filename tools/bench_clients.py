@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""Throughput and latency sweep for comparing firmware versions. For each
+client count in --sweep, N threads act like open dashboards (page load,
+WebSocket connect that pulls the history, status and GPIO toggles) for
+--seconds; the board's /metrics is reset before the step and read after
+it, so every step carries the board-side p50/p99 per route next to what
+the clients measured.
+
+  python3 tools/bench_clients.py 192.168.4.1 --out fw-1.4.json
+  python3 tools/bench_clients.py 192.168.4.1 --sweep 1,8,32 --seconds 20 --ota
+  python3 tools/bench_clients.py --compare fw-1.3.json fw-1.4.json
+
+Each step also prints the board's loop:pass p99, one pass of loop()
+over all jobs, so two sweeps show what a firmware change did to loop
+latency; --compare flags it like any route.
+
+--ota adds one thread that keeps uploading a junk image to /update. The
+board rejects it at the first byte (no 0xE9 magic) so nothing is flashed,
+but the upload path and its supervisor hold are exercised under load.
+
+All threads come from this PC's address and so share one per-IP bucket;
+on a production image the rate limit, not the board, sets the ceiling
+once N is above a few. Sweep a bench image instead (pio run -e
+nodemcu-32s-loadtest) with --unlimit, which lifts the buckets for each
+step. 429s are waited out per Retry-After, counted apart and left out of
+the latency figures.
+"""
+import argparse
+import base64
+import collections
+import json
+import os
+import socket
+import threading
+import time
+import urllib.error
+import urllib.request
+
+
+def pct(values, q):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+
+def http(host, path, timeout, data=None, headers=None):
+    req = urllib.request.Request(f"http://{host}{path}", data=data, headers=headers or {})
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as r:
+            return str(r.status), r.read()
+    except urllib.error.HTTPError as e:
+        if e.code == 429:        # budget spent: wait as told before the next request
+            time.sleep(int(e.headers.get("Retry-After", "1") or 1))
+        return str(e.code), b""
+    except Exception:
+        return "error", b""
+
+
+def ws_history(host, timeout):
+    """Connect on port 81 and read until the history frame has arrived."""
+    key = base64.b64encode(os.urandom(16)).decode()
+    try:
+        s = socket.create_connection((host, 81), timeout=timeout)
+        s.sendall((f"GET / HTTP/1.1\r\nHost: {host}\r\nUpgrade: websocket\r\n"
+                   f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+                   "Sec-WebSocket-Version: 13\r\n\r\n").encode())
+        data = b""
+        while b"\r\n\r\n" not in data:
+            chunk = s.recv(4096)
+            if not chunk:
+                return "ws_error"
+            data += chunk
+        if b" 101 " not in data.split(b"\r\n", 1)[0]:
+            return "ws_rejected"
+        data = data.split(b"\r\n\r\n", 1)[1]
+        while b"history" not in data and b'"busy"' not in data:
+            chunk = s.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+        s.close()
+        if b'"busy"' in data:
+            return "ws_busy"
+        return "ws_ok" if b"history" in data else "ws_empty"
+    except Exception:
+        return "ws_error"
+
+
+def multipart(name, filename, payload):
+    boundary = base64.b16encode(os.urandom(8)).decode()
+    body = (f"--{boundary}\r\nContent-Disposition: form-data; name=\"{name}\"; filename=\"{filename}\"\r\n"
+            "Content-Type: application/octet-stream\r\n\r\n").encode() + payload + f"\r\n--{boundary}--\r\n".encode()
+    return body, {"Content-Type": f"multipart/form-data; boundary={boundary}"}
+
+
+class Step:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.tally = collections.Counter()
+        self.latency = []            # seconds, answered 2xx only
+
+    def record(self, result, seconds):
+        with self.lock:
+            self.tally[result] += 1
+            if result.startswith("2") or result == "ws_ok":
+                self.latency.append(seconds)
+
+
+def dashboard(host, deadline, timeout, step, index):
+    i = 0
+    while time.time() < deadline:
+        kind = i % 8
+        t0 = time.time()
+        if kind == 0:
+            result = http(host, "/", timeout)[0]
+        elif kind == 1:
+            result = ws_history(host, timeout)
+        elif kind == 6:
+            state = "on" if (i // 8 + index) % 2 else "off"
+            result = http(host, f"/led2{state}", timeout)[0]
+        else:
+            result = http(host, "/status", timeout)[0]
+        step.record(result, time.time() - t0)
+        i += 1
+
+
+def ota_junk(host, deadline, timeout, step):
+    body, headers = multipart("update", "junk.bin", b"\0" * 16384)
+    while time.time() < deadline:
+        t0 = time.time()
+        status = http(host, "/update", timeout, body, headers)[0]
+        step.record("ota_" + status, time.time() - t0)
+        time.sleep(1)
+
+
+def heap_sampler(host, deadline, timeout, low):
+    while time.time() < deadline:
+        status, body = http(host, "/metrics", timeout)
+        if status == "200":
+            low.append(json.loads(body)["heap_free"])
+        time.sleep(1)
+
+
+def run_step(args, clients):
+    if args.unlimit:     # per step: the board caps one switch-off at RATE_UNLIMIT_MAX_S
+        status, body = http(args.host, f"/admission?unlimit={int(args.seconds) + 30}", args.timeout)
+        if status == "200" and b"unlimited_s" not in body:
+            raise SystemExit("--unlimit needs an ADMISSION_LOAD_TEST image (env:nodemcu-32s-loadtest)")
+    http(args.host, "/metrics?reset=1", args.timeout)
+    step = Step()
+    heap = []
+    deadline = time.time() + args.seconds
+    threads = [threading.Thread(target=dashboard, args=(args.host, deadline, args.timeout, step, i))
+               for i in range(clients)]
+    threads.append(threading.Thread(target=heap_sampler, args=(args.host, deadline, args.timeout, heap)))
+    if args.ota:
+        threads.append(threading.Thread(target=ota_junk, args=(args.host, deadline, args.timeout, step)))
+    t0 = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - t0
+
+    status, body = http(args.host, "/metrics", args.timeout)
+    board = json.loads(body) if status == "200" else {}
+    answered = len(step.latency)
+    return {
+        "clients": clients,
+        "seconds": round(elapsed, 1),
+        "answered_per_s": round(answered / elapsed, 1),
+        "client_p50_ms": round(pct(step.latency, 0.50) * 1000, 1),
+        "client_p99_ms": round(pct(step.latency, 0.99) * 1000, 1),
+        "results": dict(step.tally),
+        "heap_low_sampled": min(heap) if heap else None,
+        "heap_min_free": board.get("heap_min_free"),
+        "frames_dropped": board.get("frames_dropped"),
+        "routes": {r["route"]: r for r in board.get("routes", []) if r["count"]},
+    }
+
+
+def show(step):
+    res = " ".join(f"{k}={v}" for k, v in sorted(step["results"].items()))
+    loop_p99 = step["routes"].get("loop:pass", {}).get("p99_us")
+    print(f"{step['clients']:>3} clients  {step['answered_per_s']:>7.1f}/s  "
+          f"p50 {step['client_p50_ms']:>7.1f} ms  p99 {step['client_p99_ms']:>7.1f} ms  "
+          f"loop p99 {loop_p99} us  heap low {step['heap_low_sampled']}  dropped {step['frames_dropped']}  {res}")
+
+
+def compare(path_a, path_b, tolerance):
+    a, b = (json.load(open(p)) for p in (path_a, path_b))
+    print(f"{a['fw']} -> {b['fw']}")
+    steps_a = {s["clients"]: s for s in a["steps"]}
+    worse = 0
+    for sb in b["steps"]:
+        sa = steps_a.get(sb["clients"])
+        if not sa:
+            continue
+        checks = [("answered_per_s", -1), ("client_p99_ms", 1), ("heap_low_sampled", -1)]
+        for route, rb in sb["routes"].items():
+            ra = sa["routes"].get(route)
+            if ra:
+                checks.append((route, rb["p99_us"], ra["p99_us"]))
+        for check in checks:
+            if len(check) == 2:
+                key, sign = check
+                va, vb = sa.get(key), sb.get(key)
+                label = key
+            else:
+                label, vb, va = check
+                label, sign = f"{label} p99_us", 1
+            if not va or vb is None:
+                continue
+            change = (vb - va) / va * sign
+            if change > tolerance:
+                worse += 1
+                print(f"  {sb['clients']:>3} clients  {label:<28} {va} -> {vb}  ({change * 100:+.0f}% worse)")
+    print(f"{worse} regressions over {tolerance * 100:.0f}%")
+    return 1 if worse else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host", nargs="?")
+    ap.add_argument("--sweep", default="1,2,4,8,16,32,64", help="client counts, one step each")
+    ap.add_argument("--seconds", type=float, default=30, help="length of each step")
+    ap.add_argument("--timeout", type=float, default=5)
+    ap.add_argument("--ota", action="store_true", help="upload a rejected image throughout each step")
+    ap.add_argument("--unlimit", action="store_true", help="switch the board's per-IP limit off for the sweep")
+    ap.add_argument("--out", help="write the sweep here as JSON")
+    ap.add_argument("--compare", nargs=2, metavar=("OLD", "NEW"), help="diff two saved sweeps")
+    ap.add_argument("--tolerance", type=float, default=0.15, help="relative change reported as a regression")
+    args = ap.parse_args()
+
+    if args.compare:
+        raise SystemExit(compare(*args.compare, args.tolerance))
+    if not args.host:
+        ap.error("host is required unless --compare is given")
+
+    status, body = http(args.host, "/metrics", args.timeout)
+    if status != "200":
+        raise SystemExit(f"/metrics answered {status}")
+    report = {"fw": json.loads(body)["fw"], "host": args.host, "unlimit": args.unlimit, "steps": []}
+    counts = [int(n) for n in args.sweep.split(",")]
+    try:
+        for clients in counts:
+            step = run_step(args, clients)
+            show(step)
+            report["steps"].append(step)
+    finally:
+        if args.unlimit:
+            http(args.host, "/admission?unlimit=0", args.timeout)
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(report, f, indent=1)
+        print(f"wrote {args.out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""A site's worth of boards from one PC, for trying hub mode without the
+hardware. Each simulated peer beacons and answers snapshot requests the
+way hub.cpp does, from its own UDP socket and made-up MAC, with a
+wandering temperature. Point a hub board at them (same network, hub
+mode on) and watch /hub fill up.
+
+  python3 tools/hub_peers.py --peers 16                      broadcast beacons on the LAN
+  python3 tools/hub_peers.py --peers 16 --hub 192.168.1.50   unicast to one hub
+  python3 tools/hub_peers.py --peers 4 --hostile              one peer beacons markup as its name
+  python3 tools/hub_peers.py --selftest                      loopback check of this script
+
+--hostile names the first peer '<svg onload=alert(1)>"'; a board should
+list it as '_svg_onload_alert_1___' in /hub/peers and on /hub, with no
+alert and valid JSON.
+
+The --selftest runs these peers against MiniHub, a Python model of the
+receiving half of hub.cpp. It checks the wire format, the slot limit and
+the gap-per-missed-round behaviour of the model, not the firmware: no
+hub.cpp code runs, and fan-in on a real board has to be checked with a
+board pointed at the simulated peers.
+"""
+import argparse
+import math
+import random
+import socket
+import struct
+import threading
+import time
+
+HUB_MAGIC = 0x3142484D
+HUB_VERSION = 1
+HUB_PORT = 5141
+HUB_MAX_PEERS = 16
+HUB_NAME_LEN = 24
+HUB_BEACON, HUB_REQUEST, HUB_SNAPSHOT = 1, 2, 3
+HOSTILE_NAME = '<svg onload=alert(1)>"'
+FLAG_LED1, FLAG_LED2, FLAG_HUB = 1, 2, 4
+
+HEADER = struct.Struct("<IBB6s")
+BEACON = struct.Struct(f"<{HUB_NAME_LEN}sB")
+REQUEST = struct.Struct("<I")
+SNAPSHOT = struct.Struct("<IIIhbBB")
+assert (HEADER.size, BEACON.size, REQUEST.size, SNAPSHOT.size) == (12, 25, 4, 17)
+
+
+def packet(mac, kind, body):
+    return HEADER.pack(HUB_MAGIC, HUB_VERSION, kind, mac) + body
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        return None
+    magic, version, kind, mac = HEADER.unpack_from(data)
+    if magic != HUB_MAGIC or version != HUB_VERSION:
+        return None
+    return kind, mac, data[HEADER.size:]
+
+
+class Peer(threading.Thread):
+    def __init__(self, index, beacon_to, beacon_ms, drop=0.0):
+        super().__init__(daemon=True)
+        self.mac = bytes([0x02, 0x00, 0x00, 0x00, 0x00, index + 1])
+        self.name = f"sim-{index + 1:02d}"
+        self.beacon_to = beacon_to
+        self.beacon_s = beacon_ms / 1000
+        self.drop = drop
+        self.start_t = time.time()
+        self.phase = random.random() * 6.28
+        self.answered = 0
+        self.stop = threading.Event()
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        self.sock.bind(("0.0.0.0", 0))
+        self.sock.settimeout(0.1)
+
+    def temp_centi(self):
+        t = time.time() - self.start_t
+        return int(round((42 + 3 * math.sin(t / 30 + self.phase) + random.uniform(-0.2, 0.2)) * 100))
+
+    def run(self):
+        next_beacon = 0
+        while not self.stop.is_set():
+            now = time.time()
+            if now >= next_beacon:
+                body = BEACON.pack(self.name.encode(), 0)
+                self.sock.sendto(packet(self.mac, HUB_BEACON, body), self.beacon_to)
+                next_beacon = now + self.beacon_s
+            try:
+                data, addr = self.sock.recvfrom(256)
+            except socket.timeout:
+                continue
+            msg = parse(data)
+            if not msg or msg[0] != HUB_REQUEST or random.random() < self.drop:
+                continue
+            (rnd,) = REQUEST.unpack_from(msg[2])
+            flags = FLAG_LED1 if int(now) % 20 < 10 else FLAG_LED2
+            body = SNAPSHOT.pack(rnd, int(now - self.start_t), 200000 - self.answered, self.temp_centi(),
+                                 -55 - self.mac[5], 0, flags)
+            self.sock.sendto(packet(self.mac, HUB_SNAPSHOT, body), addr)
+            self.answered += 1
+
+
+class MiniHub:
+    """The receiving half of hub.cpp, round for round, for the loopback check."""
+
+    def __init__(self):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("127.0.0.1", 0))
+        self.sock.setblocking(False)
+        self.mac = bytes([0x02, 0xff, 0, 0, 0, 0])
+        self.peers = {}          # mac -> dict
+        self.round = 0
+        self.rejected = 0
+
+    def drain(self):
+        while True:
+            try:
+                data, addr = self.sock.recvfrom(256)
+            except BlockingIOError:
+                return
+            msg = parse(data)
+            if not msg:
+                continue
+            kind, mac, body = msg
+            if kind == HUB_BEACON:
+                if mac not in self.peers:
+                    if len(self.peers) >= HUB_MAX_PEERS:
+                        self.rejected += 1
+                        continue
+                    self.peers[mac] = {"history": [], "answered": 0}
+                p = self.peers[mac]
+                p["name"] = BEACON.unpack_from(body)[0].rstrip(b"\0").decode()
+                p["addr"] = addr
+            elif kind == HUB_SNAPSHOT and mac in self.peers:
+                snap = SNAPSHOT.unpack_from(body)
+                self.peers[mac]["answered"] = snap[0]
+                self.peers[mac]["temp"] = snap[3]
+
+    def close_round(self):
+        for p in self.peers.values():
+            p["history"].append(p["temp"] if p["answered"] == self.round else None)
+
+    def open_round(self):
+        self.round += 1
+        for p in self.peers.values():
+            self.sock.sendto(packet(self.mac, HUB_REQUEST, REQUEST.pack(self.round)), p["addr"])
+
+
+def selftest():
+    hub = MiniHub()
+    addr = hub.sock.getsockname()
+    peers = [Peer(i, addr, 200) for i in range(HUB_MAX_PEERS + 1)]  # one more than fits
+    peers[3].drop = 1.0                                             # never answers
+    for p in peers:
+        p.start()
+
+    deadline = time.time() + 1.0
+    while time.time() < deadline:
+        hub.drain()
+        time.sleep(0.01)
+    assert len(hub.peers) == HUB_MAX_PEERS, len(hub.peers)
+    assert hub.rejected > 0
+
+    rounds = 5
+    for _ in range(rounds):
+        hub.open_round()
+        end = time.time() + 0.3
+        while time.time() < end:
+            hub.drain()
+            time.sleep(0.01)
+        hub.close_round()
+
+    for p in peers:
+        p.stop.set()
+
+    silent = peers[3].mac
+    for mac, p in hub.peers.items():
+        assert len(p["history"]) == rounds
+        if mac == silent:
+            assert p["history"] == [None] * rounds
+        else:
+            assert None not in p["history"], (p["name"], p["history"])
+            assert all(3000 < v < 5000 for v in p["history"])
+    print(f"{len(hub.peers)} peers tracked, {hub.rejected} beacons rejected at the slot limit, "
+          f"{rounds} rounds, silent peer recorded as gaps")
+    print("selftest ok")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--peers", type=int, default=HUB_MAX_PEERS)
+    ap.add_argument("--hub", help="unicast beacons to this hub instead of broadcasting")
+    ap.add_argument("--beacon-ms", type=int, default=10000)
+    ap.add_argument("--drop", type=float, default=0.0, help="fraction of requests left unanswered")
+    ap.add_argument("--hostile", action="store_true", help="give the first peer a name full of markup")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        selftest()
+        return
+
+    target = (args.hub or "255.255.255.255", HUB_PORT)
+    peers = [Peer(i, target, args.beacon_ms, args.drop) for i in range(args.peers)]
+    if args.hostile and peers:
+        peers[0].name = HOSTILE_NAME
+    for p in peers:
+        p.start()
+    print(f"{len(peers)} peers beaconing to {target[0]}:{target[1]}, Ctrl-C to stop")
+    try:
+        while True:
+            time.sleep(10)
+            print("answered:", " ".join(str(p.answered) for p in peers))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
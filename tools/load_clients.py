@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Stand-in for a room full of dashboards: N threads reload the page,
+open a WebSocket (which pulls the history) and hammer the heavy routes.
+Prints how requests were answered and the board's /admission view, so
+shedding (429/503, refused sockets) can be told apart from a crash
+(timeouts, then the board dropping off the network).
+
+  python3 tools/load_clients.py 192.168.4.1 --clients 12 --seconds 60 --unlimit
+  python3 tools/load_clients.py --selftest                loopback check of this script
+
+Every thread shares this PC's address, and so one per-IP bucket (20
+back to back, 5/s after that). Threads honour Retry-After on a 429, so
+against a production image the run stays within that budget and mostly
+measures the rate limit. For a load test proper, flash the bench image
+(pio run -e nodemcu-32s-loadtest, built with ADMISSION_LOAD_TEST) and
+pass --unlimit: the board then switches the buckets off for the length
+of the run (/admission?unlimit=<s>) and back on afterwards, and 503s and
+refused sockets come from memory pressure alone. Production images
+ignore the request.
+"""
+import argparse
+import base64
+import collections
+import http.server
+import json
+import os
+import socket
+import socketserver
+import threading
+import time
+import urllib.error
+import urllib.request
+
+ROUTES = ["/", "/status", "/history", "/history/stats", "/stats", "/ota_info"]
+HEAVY = {"/history", "/history/stats", "/ota_info"}
+
+
+def http_get(host, path, timeout):
+    """Returns the status and, for a 429/503, the Retry-After seconds."""
+    try:
+        with urllib.request.urlopen(f"http://{host}{path}", timeout=timeout) as r:
+            r.read()
+            return str(r.status), 0
+    except urllib.error.HTTPError as e:
+        return str(e.code), int(e.headers.get("Retry-After", "0") or 0)
+    except Exception:
+        return "error", 0
+
+
+def get_json_retrying(host, path, timeout, attempts=4):
+    """GET that waits out a 429/503's Retry-After instead of giving up."""
+    for i in range(attempts):
+        try:
+            with urllib.request.urlopen(f"http://{host}{path}", timeout=timeout) as r:
+                return json.loads(r.read())
+        except urllib.error.HTTPError as e:
+            if e.code not in (429, 503) or i == attempts - 1:
+                raise
+            time.sleep(int(e.headers.get("Retry-After", "1")))
+
+
+def ws_connect(host, timeout, port=81):
+    """Handshake on port 81 and read the first frame; returns how it went."""
+    key = base64.b64encode(os.urandom(16)).decode()
+    try:
+        s = socket.create_connection((host.split(":")[0], port), timeout=timeout)
+        s.sendall((f"GET /?topics=temp HTTP/1.1\r\nHost: {host}\r\nUpgrade: websocket\r\n"
+                   f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+                   "Sec-WebSocket-Version: 13\r\n\r\n").encode())
+        data = s.recv(4096)
+        if b" 101 " not in data.split(b"\r\n", 1)[0]:
+            return "ws_rejected"
+        body = data.split(b"\r\n\r\n", 1)[1] or s.recv(4096)
+        s.close()
+        if b'"busy"' in body:
+            return "ws_busy"
+        return "ws_ok" if body else "ws_empty"
+    except Exception:
+        return "ws_error"
+
+
+def client(host, deadline, timeout, tally, lock, ws_port=81):
+    i = 0
+    while time.time() < deadline:
+        path = ROUTES[i % len(ROUTES)]
+        status, retry = http_get(host, path, timeout)
+        result = [status]
+        if path == "/" and status == "200":
+            result.append(ws_connect(host, timeout, ws_port))
+        with lock:
+            for r in result:
+                tally[r] += 1
+        if status == "429":
+            time.sleep(min(retry or 1, max(0, deadline - time.time())))
+        i += 1
+
+
+def run(host, clients, seconds, timeout, unlimit, ws_port=81):
+    if unlimit:
+        state = get_json_retrying(host, f"/admission?unlimit={int(seconds) + 30}", timeout)
+        if "unlimited_s" in state:
+            print(f"per-IP limits off for {state['unlimited_s']} s")
+        else:
+            print("not a load-test image (ADMISSION_LOAD_TEST): per-IP limits stay on")
+            unlimit = False
+
+    tally, lock = collections.Counter(), threading.Lock()
+    deadline = time.time() + seconds
+    threads = [threading.Thread(target=client, args=(host, deadline, timeout, tally, lock, ws_port))
+               for _ in range(clients)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    for k, v in sorted(tally.items()):
+        print(f"{k:>12} {v}")
+    try:
+        state = get_json_retrying(host, "/admission?unlimit=0" if unlimit else "/admission", timeout)
+        print(json.dumps(state, indent=2))
+    except Exception as e:
+        state = None
+        print(f"/admission unreachable: {e}")
+    return tally, state
+
+
+class MiniAdmission(http.server.BaseHTTPRequestHandler):
+    """admission.cpp's bucket for one IP, plus the unlimit switch when load_test
+    stands for an ADMISSION_LOAD_TEST image; no memory model."""
+    bucket = {"tokens": 20.0, "at": time.time(), "until": 0.0, "limited": 0}
+    load_test = True
+    lock = threading.Lock()
+
+    def log_message(self, *args):
+        pass
+
+    def take(self, cost):
+        b = self.bucket
+        now = time.time()
+        if now < b["until"]:
+            return True
+        b["tokens"] = min(20.0, b["tokens"] + (now - b["at"]) * 5)
+        b["at"] = now
+        if b["tokens"] >= cost:
+            b["tokens"] -= cost
+            return True
+        b["limited"] += 1
+        return False
+
+    def do_GET(self):
+        path, _, query = self.path.partition("?")
+        with self.lock:
+            ok = self.take(4 if path in HEAVY else 1)
+            if ok and self.load_test and query.startswith("unlimit="):
+                s = min(600, max(0, int(query[8:])))
+                self.bucket["until"] = time.time() + s if s else 0.0
+            until = self.bucket["until"]
+            limited = self.bucket["limited"]
+        if not ok:
+            self.send_response(429)
+            self.send_header("Retry-After", "1")
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+        body = b"{}"
+        if path == "/admission":
+            state = {"limited": limited}
+            if self.load_test:
+                state["unlimited_s"] = max(0, int(until - time.time()))
+            body = json.dumps(state).encode()
+        self.send_response(200)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+
+def selftest():
+    class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+        daemon_threads = True
+    srv = Server(("127.0.0.1", 0), MiniAdmission)
+    threading.Thread(target=srv.serve_forever, daemon=True).start()
+    host = f"127.0.0.1:{srv.server_address[1]}"
+    closed = socket.socket()
+    closed.bind(("127.0.0.1", 0))
+    ws_port = closed.getsockname()[1]          # bound, never listening: WebSocket attempts fail fast
+
+    print("-- limited")
+    tally, _ = run(host, 12, 3, 2, False, ws_port)
+    # 20 of burst plus 5/s; threads back off on 429 instead of hammering
+    assert tally["200"] <= 20 + 5 * 4 and tally["429"] <= 12 * 4, tally
+    time.sleep(4)                              # bucket back to a full burst
+
+    print("-- --unlimit")
+    tally, state = run(host, 12, 3, 2, True, ws_port)
+    assert tally["429"] == 0 and tally["200"] > 0, tally
+    assert state and state["unlimited_s"] == 0, state
+    time.sleep(4)
+
+    print("-- --unlimit against a production image")
+    MiniAdmission.load_test = False
+    tally, state = run(host, 12, 3, 2, True, ws_port)
+    assert tally["429"] > 0 and "unlimited_s" not in state, (tally, state)
+    srv.shutdown()
+    print("selftest ok")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host", nargs="?")
+    ap.add_argument("--clients", type=int, default=8)
+    ap.add_argument("--seconds", type=float, default=30)
+    ap.add_argument("--timeout", type=float, default=5)
+    ap.add_argument("--unlimit", action="store_true", help="switch the board's per-IP limit off for the run")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        selftest()
+        return
+    if not args.host:
+        ap.error("host is required")
+    run(args.host, args.clients, args.seconds, args.timeout, args.unlimit)
+
+
+if __name__ == "__main__":
+    main()
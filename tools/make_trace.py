@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Write a synthetic trace for /replay: one temperature sample a second
+plus a dashboard polling /status and /stats, in the record format of
+include/trace_replay.h (<IBB, little-endian).
+
+  python3 tools/make_trace.py --hours 24 -o trace.bin
+  curl -F "file=@trace.bin" http://<device>/trace
+  curl "http://<device>/replay?start=1&hold=1"
+  curl "http://<device>/replay?history=1&last=600"       replayed series; live /history is untouched
+"""
+import argparse
+import math
+import random
+import struct
+
+TRACE_SAMPLE, TRACE_REQUEST = 0, 1
+REQ_STATUS, REQ_STATS, REQ_HISTORY, REQ_PAGE = 0, 1, 2, 6
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--hours", type=float, default=24)
+    ap.add_argument("--poll", type=int, default=5, help="seconds between dashboard polls")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("-o", "--out", default="trace.bin")
+    args = ap.parse_args()
+
+    rnd = random.Random(args.seed)
+    rec = struct.Struct("<IBB")
+    seconds = int(args.hours * 3600)
+    with open(args.out, "wb") as f:
+        f.write(rec.pack(0, TRACE_REQUEST, REQ_PAGE))
+        f.write(rec.pack(0, TRACE_REQUEST, REQ_HISTORY))
+        for s in range(seconds):
+            ms = s * 1000
+            # Daily swing around 50 degC, in the sensor's raw Fahrenheit byte
+            c = 50 + 8 * math.sin(2 * math.pi * s / 86400) + rnd.gauss(0, 0.6)
+            f.write(rec.pack(ms, TRACE_SAMPLE, max(0, min(255, round(c * 1.8 + 32)))))
+            if s % args.poll == 0:
+                f.write(rec.pack(ms + 200, TRACE_REQUEST, REQ_STATUS))
+                f.write(rec.pack(ms + 210, TRACE_REQUEST, REQ_STATS))
+    print(f"{args.out}: {seconds} samples")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""Just enough of an MQTT 3.1.1 broker to test the board against:
+CONNECT, PUBLISH (QoS 0/1), SUBSCRIBE, PINGREQ and DISCONNECT, with
+retained messages and the last will. Prints publishes per second and
+payload bytes per topic every --report seconds.
+
+  python3 tools/mqtt_broker_standin.py --port 1883
+  python3 tools/mqtt_broker_standin.py --cmd mingledash/a1b2c3/cmd/led1=on
+  curl "http://<board>/mqtt?host=<this machine>&enable=1"
+
+--cmd is sent to each client that subscribes to a matching filter.
+"""
+import argparse
+import collections
+import socketserver
+import struct
+import threading
+import time
+
+lock = threading.Lock()
+clients = {}                       # handler -> list of topic filters
+retained = {}
+counts = collections.Counter()
+sizes = collections.Counter()
+
+
+def matches(filt, topic):
+    f, t = filt.split("/"), topic.split("/")
+    for i, part in enumerate(f):
+        if part == "#":
+            return True
+        if i >= len(t) or (part != "+" and part != t[i]):
+            return False
+    return len(f) == len(t)
+
+
+def encode_len(n):
+    out = bytearray()
+    while True:
+        b, n = n % 128, n // 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def publish_packet(topic, payload, retain=False):
+    t = topic.encode()
+    body = struct.pack(">H", len(t)) + t + payload
+    return bytes([0x30 | (1 if retain else 0)]) + encode_len(len(body)) + body
+
+
+def utf8(buf, i):
+    n = struct.unpack_from(">H", buf, i)[0]
+    return buf[i + 2:i + 2 + n].decode(), i + 2 + n
+
+
+class Handler(socketserver.BaseRequestHandler):
+    def read_packet(self):
+        head = self.request.recv(1)
+        if not head:
+            return None, None
+        n, mult = 0, 1
+        while True:
+            b = self.request.recv(1)[0]
+            n += (b & 0x7F) * mult
+            mult *= 128
+            if not b & 0x80:
+                break
+        body = b""
+        while len(body) < n:
+            chunk = self.request.recv(n - len(body))
+            if not chunk:
+                return None, None
+            body += chunk
+        return head[0], body
+
+    def send(self, data):
+        with lock:
+            self.request.sendall(data)
+
+    def route(self, topic, payload, retain):
+        with lock:
+            counts[topic] += 1
+            sizes[topic] += len(payload)
+            if retain:
+                retained[topic] = payload
+            targets = [h for h, fs in clients.items() if any(matches(f, topic) for f in fs)]
+        for h in targets:
+            try:
+                h.send(publish_packet(topic, payload))
+            except OSError:
+                pass
+
+    def handle(self):
+        will = None
+        clean = False
+        try:
+            while True:
+                kind, body = self.read_packet()
+                if kind is None:
+                    break
+                ptype = kind >> 4
+                if ptype == 1:                                  # CONNECT
+                    _, i = utf8(body, 0)
+                    flags = body[i + 1]
+                    cid, j = utf8(body, i + 4)
+                    if flags & 0x04:
+                        wt, j = utf8(body, j)
+                        wl = struct.unpack_from(">H", body, j)[0]
+                        will = (wt, body[j + 2:j + 2 + wl], bool(flags & 0x20))
+                    print(f"connect {cid} from {self.client_address[0]}")
+                    with lock:
+                        clients[self] = []
+                    self.send(b"\x20\x02\x00\x00")
+                elif ptype == 3:                                # PUBLISH
+                    topic, i = utf8(body, 0)
+                    qos = (kind >> 1) & 3
+                    if qos:
+                        self.send(b"\x40\x02" + body[i:i + 2])
+                        i += 2
+                    self.route(topic, body[i:], bool(kind & 1))
+                elif ptype == 8:                                # SUBSCRIBE
+                    pid, i, granted, filters = body[:2], 2, b"", []
+                    while i < len(body):
+                        f, i = utf8(body, i)
+                        i += 1
+                        filters.append(f)
+                        granted += b"\x00"
+                    with lock:
+                        clients[self] += filters
+                        hits = [(t, p) for t, p in retained.items() if any(matches(f, t) for f in filters)]
+                    self.send(b"\x90" + encode_len(2 + len(granted)) + pid + granted)
+                    for t, p in hits:
+                        self.send(publish_packet(t, p, True))
+                    for t, p in self.server.commands:
+                        if any(matches(f, t) for f in filters):
+                            print(f"command {t} = {p.decode()}")
+                            self.send(publish_packet(t, p))
+                elif ptype == 12:                               # PINGREQ
+                    self.send(b"\xd0\x00")
+                elif ptype == 14:                               # DISCONNECT
+                    clean = True
+                    break
+        except (OSError, IndexError, struct.error):
+            pass
+        finally:
+            with lock:
+                clients.pop(self, None)
+            if will and not clean:
+                self.route(*will)
+
+
+class Broker(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def report(every):
+    last, last_t = collections.Counter(), time.time()
+    while True:
+        time.sleep(every)
+        with lock:
+            now_counts, now_sizes = counts.copy(), sizes.copy()
+        now = time.time()
+        total = sum(now_counts.values()) - sum(last.values())
+        print(f"--- {total / (now - last_t):.2f} publishes/s")
+        for topic in sorted(now_counts):
+            n = now_counts[topic]
+            print(f"{topic:40} {n:6} msgs {now_sizes[topic] / n:8.1f} B avg")
+        last, last_t = now_counts, now
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--report", type=float, default=10)
+    ap.add_argument("--cmd", action="append", default=[], help="TOPIC=PAYLOAD sent to matching subscribers")
+    args = ap.parse_args()
+
+    broker = Broker(("", args.port), Handler)
+    broker.commands = [(c.split("=", 1)[0], c.split("=", 1)[1].encode()) for c in args.cmd]
+    threading.Thread(target=report, args=(args.report,), daemon=True).start()
+    print(f"listening on :{args.port}")
+    broker.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+"""Resumable download from the board, and a check that resuming works.
+Fetches a /file or /partition URL, optionally dropping the connection
+every --cut bytes and carrying on with Range + If-Range, then reports
+throughput, how many resumes it took, and the SHA-256 of the result.
+With --verify the same URL is also fetched in one go and compared.
+
+  python3 tools/range_fetch.py 192.168.4.1 "/partition?name=ota_0" -o ota_0.bin
+  python3 tools/range_fetch.py 192.168.4.1 "/file?path=/tempData.csv" -o t.csv --cut 65536 --verify
+  python3 tools/range_fetch.py 192.168.4.1 "/partition?name=ota_0" --rate 64 --watch-restart
+  python3 tools/range_fetch.py --selftest                    loopback check
+
+--rate caps the read speed so a download outlasts the supervisor's 15 s
+reboot limit (at 64 kB/s each MB of image takes 16 s);
+--watch-restart reads /status uptime before and after and says whether
+the board restarted while it was streaming.
+"""
+import json
+import argparse
+import hashlib
+import http.client
+import os
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+READ_SIZE = 4096
+
+
+class Transfer:
+    def __init__(self):
+        self.data = bytearray()
+        self.total = None
+        self.etag = None
+        self.requests = 0
+        self.resumes = 0
+        self.statuses = []
+
+
+def fetch_once(host, port, path, xfer, cut, timeout, rate=0):
+    """One request; returns True once the body is complete."""
+    headers = {}
+    if xfer.data:
+        headers["Range"] = f"bytes={len(xfer.data)}-"
+        if xfer.etag:
+            headers["If-Range"] = xfer.etag
+        xfer.resumes += 1
+
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    conn.request("GET", path, headers=headers)
+    r = conn.getresponse()
+    xfer.requests += 1
+    xfer.statuses.append(r.status)
+
+    if r.status == 200:
+        if xfer.data:               # If-Range mismatch: the resource changed, start over
+            xfer.data.clear()
+        xfer.total = int(r.getheader("Content-Length"))
+    elif r.status == 206:
+        first, rest = r.getheader("Content-Range").split(" ", 1)[1].split("-", 1)
+        total = int(rest.split("/", 1)[1])
+        if int(first) != len(xfer.data):
+            raise RuntimeError(f"asked for {len(xfer.data)}-, got {first}-")
+        xfer.total = total
+    else:
+        raise RuntimeError(f"HTTP {r.status} {r.reason}")
+    xfer.etag = r.getheader("ETag") or xfer.etag
+
+    got = 0
+    began = time.time()
+    while len(xfer.data) < xfer.total:
+        want = READ_SIZE if not cut else min(READ_SIZE, cut - got)
+        chunk = r.read(want)
+        if not chunk:
+            break
+        xfer.data += chunk
+        got += len(chunk)
+        if rate:                    # a slow link: the board's socket writes block on a full window
+            ahead = got / (rate * 1024) - (time.time() - began)
+            if ahead > 0:
+                time.sleep(ahead)
+        if cut and got >= cut:
+            break                   # simulate the link dropping mid-body
+    conn.close()
+    return len(xfer.data) >= xfer.total
+
+
+def fetch(host, port, path, cut=0, timeout=10, max_requests=10000, rate=0):
+    xfer = Transfer()
+    start = time.time()
+    while xfer.requests < max_requests:
+        if fetch_once(host, port, path, xfer, cut, timeout, rate):
+            break
+    xfer.seconds = time.time() - start
+    return xfer
+
+
+def report(label, xfer):
+    kbps = len(xfer.data) / 1024 / xfer.seconds if xfer.seconds > 0 else 0
+    print(f"{label}: {len(xfer.data)} bytes in {xfer.seconds:.2f} s ({kbps:.1f} kB/s), "
+          f"{xfer.requests} requests, {xfer.resumes} resumes, "
+          f"sha256 {hashlib.sha256(xfer.data).hexdigest()}")
+
+
+def board_uptime(host, port, timeout):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    conn.request("GET", "/status")
+    r = conn.getresponse()
+    body = r.read()
+    conn.close()
+    if r.status != 200:
+        raise RuntimeError(f"/status: HTTP {r.status}")
+    return json.loads(body)["uptime"]
+
+
+# ---------- loopback check ----------
+
+def parse_range(header, size):
+    """Same rules as http_range.cpp: (offset, len), 'unsatisfiable' or None."""
+    if not header.startswith("bytes=") or "," in header:
+        return None
+    first, _, last = header[6:].partition("-")
+    first, last = first.strip(), last.strip()
+    if not (first.isdigit() or first == "") or not (last.isdigit() or last == ""):
+        return None
+    if first == "":
+        if last == "":
+            return None
+        suffix = int(last)
+        if suffix == 0 or size == 0:
+            return "unsatisfiable"
+        n = min(suffix, size)
+        return size - n, n
+    start = int(first)
+    end = int(last) if last else size - 1
+    if last and end < start:
+        return None
+    if start >= size:
+        return "unsatisfiable"
+    return start, min(end, size - 1) - start + 1
+
+
+def make_handler(blob, etag):
+    started = time.time()
+
+    class Handler(BaseHTTPRequestHandler):
+        def log_message(self, *args):
+            pass
+
+        def do_GET(self):
+            if self.path == "/status":
+                body = json.dumps({"uptime": int(time.time() - started)}).encode()
+                self.send_response(200)
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+                return
+            offset, length, code = 0, len(blob), 200
+            rng = self.headers.get("Range")
+            if rng and self.headers.get("If-Range", etag) == etag:
+                parsed = parse_range(rng, len(blob))
+                if parsed == "unsatisfiable":
+                    self.send_response(416)
+                    self.send_header("Content-Range", f"bytes */{len(blob)}")
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+                if parsed:
+                    offset, length = parsed
+                    code = 206
+            self.send_response(code)
+            self.send_header("Accept-Ranges", "bytes")
+            self.send_header("ETag", etag)
+            if code == 206:
+                self.send_header("Content-Range", f"bytes {offset}-{offset + length - 1}/{len(blob)}")
+            self.send_header("Content-Length", str(length))
+            self.end_headers()
+            try:
+                self.wfile.write(blob[offset:offset + length])
+            except (BrokenPipeError, ConnectionResetError):
+                pass
+    return Handler
+
+
+def selftest():
+    blob = os.urandom(300 * 1024 + 123)
+    srv = ThreadingHTTPServer(("127.0.0.1", 0), make_handler(blob, '"v1"'))
+    threading.Thread(target=srv.serve_forever, daemon=True).start()
+    port = srv.server_address[1]
+
+    whole = fetch("127.0.0.1", port, "/x")
+    assert bytes(whole.data) == blob and whole.statuses == [200]
+
+    cut = fetch("127.0.0.1", port, "/x", cut=50000)
+    assert bytes(cut.data) == blob, "resumed download differs"
+    assert cut.statuses[0] == 200 and set(cut.statuses[1:]) == {206}
+    assert cut.resumes == len(blob) // 50000
+
+    # A changed resource (ETag mismatch) must restart from zero, not splice
+    xfer = Transfer()
+    xfer.data += b"stale"
+    xfer.etag = '"v0"'
+    while not fetch_once("127.0.0.1", port, "/x", xfer, 0, 5):
+        pass
+    assert bytes(xfer.data) == blob and xfer.statuses == [200]
+
+    assert parse_range("bytes=0-0", 10) == (0, 1)
+    assert parse_range("bytes=-4", 10) == (6, 4)
+    assert parse_range("bytes=8-", 10) == (8, 2)
+    assert parse_range("bytes=5-100", 10) == (5, 5)
+    assert parse_range("bytes=10-", 10) == "unsatisfiable"
+    assert parse_range("bytes=0-1,4-5", 10) is None
+    assert parse_range("bytes=5-2", 10) is None
+    conn = http.client.HTTPConnection("127.0.0.1", port)
+    conn.request("GET", "/x", headers={"Range": f"bytes={len(blob)}-"})
+    assert conn.getresponse().status == 416
+
+    # Paced at 50 kB/s with resumes every 100 kB: six seconds, and the uptime check sees no restart
+    before = board_uptime("127.0.0.1", port, 5)
+    paced = fetch("127.0.0.1", port, "/x", cut=100 * 1024, rate=50)
+    assert bytes(paced.data) == blob and paced.seconds >= len(blob) / 1024 / 50 * 0.9, paced.seconds
+    assert board_uptime("127.0.0.1", port, 5) >= before
+
+    srv.shutdown()
+    report("selftest (interrupted every 50000 B)", cut)
+    report("selftest (50 kB/s)", paced)
+    print("selftest ok")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host", nargs="?")
+    ap.add_argument("path", nargs="?")
+    ap.add_argument("-o", "--output")
+    ap.add_argument("--port", type=int, default=80)
+    ap.add_argument("--cut", type=int, default=0, help="drop the connection every N bytes and resume")
+    ap.add_argument("--verify", action="store_true", help="also fetch in one go and compare")
+    ap.add_argument("--timeout", type=float, default=10)
+    ap.add_argument("--rate", type=float, default=0, help="cap the read speed, kB/s")
+    ap.add_argument("--watch-restart", action="store_true", help="check /status uptime across the download")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        selftest()
+        return
+    if not args.host or not args.path:
+        ap.error("host and path are required")
+
+    before = board_uptime(args.host, args.port, args.timeout) if args.watch_restart else None
+    xfer = fetch(args.host, args.port, args.path, args.cut, args.timeout, rate=args.rate)
+    report("interrupted" if args.cut else "download", xfer)
+    if before is not None:
+        after = board_uptime(args.host, args.port, args.timeout)
+        if after < before + int(xfer.seconds) - 2:
+            print(f"BOARD RESTARTED during the download (uptime {before} s -> {after} s)")
+        else:
+            print(f"board stayed up ({xfer.seconds:.0f} s transfer, uptime {before} s -> {after} s)")
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(xfer.data)
+
+    if args.verify:
+        whole = fetch(args.host, args.port, args.path, 0, args.timeout)
+        report("one-shot", whole)
+        print("match" if whole.data == xfer.data else "MISMATCH")
+
+
+if __name__ == "__main__":
+    main()
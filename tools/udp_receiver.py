@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Collector for the board's UDP telemetry (include/udp_export.h).
+
+  python3 tools/udp_receiver.py --port 5140                  unicast
+  python3 tools/udp_receiver.py --group 239.0.0.50           multicast
+  python3 tools/udp_receiver.py --selftest                   loopback check
+
+Prints one line per datagram and reports sequence gaps as lost datagrams.
+"""
+import argparse
+import socket
+import struct
+import sys
+
+MAGIC = 0x3154444D
+HEADER = struct.Struct("<IBBHIIIIb3xI")
+SAMPLE = struct.Struct("<Hh")
+FLAG_LED1, FLAG_LED2 = 0x01, 0x02
+
+
+def decode(data):
+    if len(data) < HEADER.size:
+        raise ValueError("short datagram")
+    magic, version, flags, count, seq, uptime, heap, heap_min, rssi, t0 = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 1:
+        raise ValueError("not a telemetry datagram")
+    if len(data) != HEADER.size + count * SAMPLE.size:
+        raise ValueError("length does not match sample count")
+    samples = []
+    for i in range(count):
+        dt, v = SAMPLE.unpack_from(data, HEADER.size + i * SAMPLE.size)
+        samples.append(((t0 + dt) / 10.0, v / 100.0))
+    return {"seq": seq, "uptime": uptime, "heap": heap, "heap_min": heap_min, "rssi": rssi,
+            "led1": bool(flags & FLAG_LED1), "led2": bool(flags & FLAG_LED2), "samples": samples}
+
+
+def encode(seq, samples, uptime=0, heap=0, heap_min=0, rssi=0, flags=0):
+    """Inverse of decode(), for tests; samples are (seconds, degC) pairs."""
+    t0 = round(samples[0][0] * 10) if samples else 0
+    out = HEADER.pack(MAGIC, 1, flags, len(samples), seq, uptime, heap, heap_min, rssi, t0)
+    for t, v in samples:
+        out += SAMPLE.pack(round(t * 10) - t0, round(v * 100))
+    return out
+
+
+class Tracker:
+    """Counts datagrams lost between consecutive sequence numbers."""
+    def __init__(self):
+        self.last = None
+        self.received = 0
+        self.lost = 0
+
+    def see(self, seq):
+        if self.last is not None and seq > self.last + 1:
+            self.lost += seq - self.last - 1
+        self.last = seq
+        self.received += 1
+
+
+def open_socket(port, group):
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(("", port))
+    if group:
+        mreq = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+        s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return s
+
+
+def selftest():
+    rx = open_socket(0, None)
+    rx.settimeout(2)
+    port = rx.getsockname()[1]
+    tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sent = [encode(0, [(10.0, 41.5), (11.0, 41.62)], flags=FLAG_LED1),
+            encode(1, []),
+            encode(3, [(12.0, -3.25)], rssi=-61)]
+    for d in sent:
+        tx.sendto(d, ("127.0.0.1", port))
+
+    tracker = Tracker()
+    got = []
+    for _ in sent:
+        m = decode(rx.recv(2048))
+        tracker.see(m["seq"])
+        got.append(m)
+    assert got[0]["samples"] == [(10.0, 41.5), (11.0, 41.62)] and got[0]["led1"]
+    assert got[1]["samples"] == []
+    assert got[2]["rssi"] == -61 and got[2]["samples"] == [(12.0, -3.25)]
+    assert tracker.received == 3 and tracker.lost == 1
+    print("selftest ok")
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--port", type=int, default=5140)
+    ap.add_argument("--group", help="multicast group to join")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        selftest()
+        return
+
+    s = open_socket(args.port, args.group)
+    trackers = {}
+    while True:
+        data, (addr, _) = s.recvfrom(2048)
+        try:
+            m = decode(data)
+        except ValueError as e:
+            print(f"{addr}: {e}", file=sys.stderr)
+            continue
+        t = trackers.setdefault(addr, Tracker())
+        t.see(m["seq"])
+        last = f"{m['samples'][-1][1]:.2f} C" if m["samples"] else "-"
+        print(f"{addr} seq={m['seq']} up={m['uptime']}s heap={m['heap']} rssi={m['rssi']} "
+              f"led={int(m['led1'])}{int(m['led2'])} samples={len(m['samples'])} last={last} lost={t.lost}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Connection-churn soak for the frame and scratch pools. Keeps up to
+--clients WebSocket clients open, each for a random few seconds, and
+replaces every one that closes, paced to --rate connects per second. Every
+--sample-s it reads `largest` (the heap's largest free block) from
+/admission and the pool counters from /status, and prints one row.
+
+  python3 tools/ws_soak.py 192.168.4.1 --minutes 60 --csv soak.csv
+
+The verdict compares the median `largest` of the first and last three
+samples. With the pools doing their job the two match to within
+--tolerance bytes however long the run; a steady slide means something
+on the connect or send path still allocates from the general heap.
+
+The default --rate of 4 connects per second stays inside the per-IP
+budget (RATE_PER_S in admission.h) together with the sampling requests,
+so refused sockets mean memory pressure, not the rate limit.
+"""
+import argparse
+import base64
+import json
+import os
+import random
+import socket
+import statistics
+import threading
+import time
+import urllib.request
+
+
+def get_json(host, path, timeout):
+    with urllib.request.urlopen(f"http://{host}{path}", timeout=timeout) as r:
+        return json.loads(r.read())
+
+
+class Client(threading.Thread):
+    """One dashboard: connect, read frames for its lifetime, close."""
+
+    def __init__(self, host, port, lifetime, tally, lock):
+        super().__init__(daemon=True)
+        self.host, self.port, self.lifetime = host, port, lifetime
+        self.tally, self.lock = tally, lock
+
+    def count(self, key):
+        with self.lock:
+            self.tally[key] = self.tally.get(key, 0) + 1
+
+    def run(self):
+        key = base64.b64encode(os.urandom(16)).decode()
+        try:
+            s = socket.create_connection((self.host, self.port), timeout=5)
+            s.sendall((f"GET / HTTP/1.1\r\nHost: {self.host}\r\nUpgrade: websocket\r\n"
+                       f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+                       "Sec-WebSocket-Version: 13\r\n\r\n").encode())
+            head = s.recv(4096)
+            if b" 101 " not in head.split(b"\r\n", 1)[0]:
+                self.count("rejected")
+                return
+            s.settimeout(1)
+            try:
+                first = head.split(b"\r\n\r\n", 1)[1] or s.recv(4096)
+            except socket.timeout:
+                first = b""
+            if b'"busy"' in first:         # refused after the handshake
+                self.count("busy")
+                return
+            self.count("connected")
+            end = time.time() + self.lifetime
+            s.settimeout(0.5)
+            while time.time() < end:
+                try:
+                    if not s.recv(4096):
+                        self.count("dropped")
+                        return
+                except socket.timeout:
+                    pass
+            s.close()
+        except Exception:
+            self.count("error")
+
+
+def sample(host, timeout):
+    adm = get_json(host, "/admission", timeout)
+    pools = get_json(host, "/status", timeout)["pools"]
+    return {
+        "t": round(time.time()),
+        "free": adm["free"],
+        "largest": adm["largest"],
+        "lowest_largest": adm["lowest_largest"],
+        "ws_refused": adm["ws_refused"],
+        "sessions": pools["sessions"]["used"],
+        "frame_used": pools["frame"]["used"],
+        "frame_peak": pools["frame"]["peak"],
+        "frame_misses": pools["frame"]["misses"],
+        "scratch_misses": pools["scratch"]["misses"],
+    }
+
+
+def verdict(rows, tolerance):
+    if len(rows) < 6:
+        return "too few samples for a verdict", True
+    start = statistics.median(r["largest"] for r in rows[:3])
+    end = statistics.median(r["largest"] for r in rows[-3:])
+    low = min(r["largest"] for r in rows)
+    ok = end >= start - tolerance
+    text = (f"largest free block {start:.0f} -> {end:.0f} B (lowest sample {low}), "
+            f"{'flat' if ok else 'shrinking'} within {tolerance} B")
+    return text, ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host")
+    ap.add_argument("--ws-port", type=int, default=81)
+    ap.add_argument("--clients", type=int, default=6, help="sockets held open at once")
+    ap.add_argument("--rate", type=float, default=4, help="connects per second at most")
+    ap.add_argument("--life", default="1,10", help="min,max seconds a client stays connected")
+    ap.add_argument("--minutes", type=float, default=30)
+    ap.add_argument("--sample-s", type=float, default=10)
+    ap.add_argument("--tolerance", type=int, default=1024, help="bytes the largest block may lose")
+    ap.add_argument("--timeout", type=float, default=5)
+    ap.add_argument("--csv", help="write every sample here")
+    args = ap.parse_args()
+
+    life_min, life_max = (float(x) for x in args.life.split(","))
+    tally, lock = {}, threading.Lock()
+    clients = []
+    rows = []
+    deadline = time.time() + args.minutes * 60
+    next_sample = 0
+    ws_host = args.host.split(":")[0]
+
+    print(f"{'t':>6} {'free':>7} {'largest':>8} {'lowest':>7} {'refused':>7} "
+          f"{'sess':>4} {'frame':>5} {'peak':>4} {'miss':>5} {'smiss':>5}")
+    t0 = time.time()
+    while time.time() < deadline:
+        clients = [c for c in clients if c.is_alive()]
+        if len(clients) < args.clients:
+            c = Client(ws_host, args.ws_port, random.uniform(life_min, life_max), tally, lock)
+            c.start()
+            clients.append(c)
+        if time.time() >= next_sample:
+            next_sample = time.time() + args.sample_s
+            try:
+                r = sample(args.host, args.timeout)
+            except Exception as e:
+                print(f"sample failed: {e}")
+            else:
+                rows.append(r)
+                print(f"{r['t'] - round(t0):>6} {r['free']:>7} {r['largest']:>8} {r['lowest_largest']:>7} "
+                      f"{r['ws_refused']:>7} {r['sessions']:>4} {r['frame_used']:>5} {r['frame_peak']:>4} "
+                      f"{r['frame_misses']:>5} {r['scratch_misses']:>5}")
+        time.sleep(1 / args.rate)
+
+    for c in clients:
+        c.join(timeout=life_max + 1)
+    if args.csv and rows:
+        with open(args.csv, "w") as f:
+            f.write(",".join(rows[0]) + "\n")
+            for r in rows:
+                f.write(",".join(str(v) for v in r.values()) + "\n")
+    print("clients:", " ".join(f"{k}={v}" for k, v in sorted(tally.items())))
+    text, ok = verdict(rows, args.tolerance)
+    print(text)
+    raise SystemExit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()